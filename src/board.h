@@ -0,0 +1,131 @@
+#ifndef _BOARD_H_
+#define _BOARD_H_
+
+#include <avr/io.h>
+#include "pins.h"
+
+// Device register naming differences, so the firmware can use one spelling
+
+#if !defined(WDIE) && defined(WDTIE)
+#define WDIE                                WDTIE       // ATtiny13A naming
+#endif
+#if !defined(WDTCR) && defined(WDTCSR)
+#define WDTCR                               WDTCSR      // ATtiny2313A naming
+#endif
+#if !defined(PCMSK) && defined(PCMSK0)
+#define PCMSK                               PCMSK0      // ATtiny2313A naming
+#endif
+#if !defined(PCIE) && defined(PCIE0)
+#define PCIE                                PCIE0       // ATtiny2313A naming
+#endif
+#if !defined(PCINT0_vect) && defined(PCINT_B_vect)
+#define PCINT0_vect                         PCINT_B_vect
+#endif
+#if !defined(WDT_vect) && defined(WDT_OVERFLOW_vect)
+#define WDT_vect                            WDT_OVERFLOW_vect
+#endif
+#if !defined(TIMSK) && defined(TIMSK0)
+#define TIMSK                               TIMSK0      // ATtiny13A naming
+#endif
+#if !defined(PSR0) && defined(PSR10)
+#define PSR0                                PSR10       // ATtiny13A, ATtiny2313A naming
+#endif
+#if !defined(TIMER0_COMPA_vect) && defined(TIM0_COMPA_vect)
+#define TIMER0_COMPA_vect                   TIM0_COMPA_vect
+#endif
+
+// Board descriptors. A port to another AVR or another wiring is a new block
+// here; main.cpp only refers to the roles below.
+//
+//    ButtonPin                 - mode button, active low, on the PORTB
+//                                pin-change interrupt (PCINTn == PBn)
+//    ShotButtonPin             - single-shot button, active low, on the
+//                                pin-change interrupt SHOT_BUTTON_vect,
+//                                enabled by SHOT_BUTTON_PCMSK/_PCIE
+//    LedPin                    - IR LED, active high
+//    TracePin                  - soft-UART output of the _TRACE_ dump
+//    FocusPin, ShutterPin      - wired release, active high into the
+//                                optocouplers of the focus and shutter lines
+//    SrDataPin, SrLatchPin,
+//    SrClockPin                - 74HC595 driving the 7-segment
+//    SegmentPort, Segment5Pin,
+//    DotPin                    - 7-segment wired directly, _HA.._HG on bits
+//                                0..6 of SegmentPort but bit 5, _HF, on
+//                                Segment5Pin, _HH on DotPin; the
+//                                SEGMENT_INPUTS bits of SegmentPort are
+//                                pulled-up inputs
+//    StepPin, DirPin           - step and direction inputs of a stepper
+//                                driver, StepPin on OC0A
+//    SupplyTapPin              - AIN1, on a divider of the supply
+//
+//    BOARD_DIRECT_DISPLAY      - SegmentPort/Segment5Pin/DotPin instead of the
+//                                74HC595
+//    BOARD_IR_TIMER1           - LedPin is OC1A, carrier made by Timer1
+//    BOARD_WIRED_RELEASE       - FocusPin/ShutterPin exist, see _WIRED_RELEASE_
+//    BOARD_SHOT_BUTTON         - ShotButtonPin exists
+//    BOARD_MOTION              - StepPin/DirPin exist, see _MOTION_
+//    BOARD_POWER_FAIL          - SupplyTapPin exists, see _POWER_FAIL_
+//    BOARD_TRACE_INVERTED      - TracePin idles low, see trace.h
+
+#if defined(__AVR_ATtiny2313A__)
+// sch/eos450d.sch, except that the 7-segment is wired straight to the MCU.
+// The ISP header shares PB5 (MOSI), PB6 (MISO) and PB7 (SCK). Only outputs
+// that can take the programming traffic sit there: the motor direction, the
+// trace line and a segment. Shutter, focus and the buttons are elsewhere.
+#ifdef _POWER_FAIL_
+// the supply divider takes AIN1, S2 moves to PB0
+typedef Pin<PortB, PB0>                     ButtonPin;
+typedef Pin<PortB, PB1>                     SupplyTapPin;   // AIN1
+#define BOARD_POWER_FAIL
+#else
+typedef Pin<PortB, PB1>                     ButtonPin;      // S2, BUTTON
+#endif
+typedef Pin<PortD, PD5>                     ShotButtonPin;  // S1, BTN_PUSH
+#define SHOT_BUTTON_vect                    PCINT_D_vect
+#define SHOT_BUTTON_PCMSK                   PCMSK2
+#define SHOT_BUTTON_PCIE                    PCIE2
+#define BOARD_SHOT_BUTTON
+typedef Pin<PortB, PB3>                     LedPin;         // OC1A
+typedef PortD                               SegmentPort;    // PD0..PD6
+typedef Pin<PortB, PB7>                     Segment5Pin;    // SCK, PD5 is S1
+#define SEGMENT_INPUTS                      ShotButtonPin::mask
+typedef Pin<PortA, PA0>                     DotPin;
+typedef Pin<PortB, PB6>                     TracePin;       // MISO
+typedef Pin<PortB, PB4>                     FocusPin;       // spare, 2.5 mm jack ring
+typedef Pin<PortA, PA1>                     ShutterPin;     // spare, 2.5 mm jack tip
+typedef Pin<PortB, PB2>                     StepPin;        // spare, OC0A
+typedef Pin<PortB, PB5>                     DirPin;         // MOSI
+#define BOARD_DIRECT_DISPLAY
+#define BOARD_IR_TIMER1
+#define BOARD_WIRED_RELEASE
+#define BOARD_MOTION
+#elif defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny13A__)
+// every pin but RESET is taken, no ShotButtonPin
+typedef Pin<PortB, PB0>                     SrDataPin;      // 14 pin
+typedef Pin<PortB, PB1>                     SrLatchPin;     // 12 pin
+typedef Pin<PortB, PB2>                     SrClockPin;     // 11 pin
+typedef Pin<PortB, PB3>                     ButtonPin;
+typedef Pin<PortB, PB4>                     LedPin;
+typedef LedPin                              TracePin;       // no spare pin
+#define BOARD_TRACE_INVERTED
+#else
+#error "No board descriptor for this MCU"
+#endif
+
+// Port letter and bit of LedPin and ButtonPin as the absolute symbols
+// __board_led_port/_bit and __board_button_port/_bit of the .elf, where
+// tools/sim.h looks them up. Emits no code; main() calls it once.
+#ifdef __AVR__
+#define BOARD_SYMBOLS()                                                         \
+    asm volatile (".global __board_led_port\n\t.set __board_led_port, %c0\n\t"  \
+                  ".global __board_led_bit\n\t.set __board_led_bit, %c1\n\t"    \
+                  ".global __board_button_port\n\t"                             \
+                  ".set __board_button_port, %c2\n\t"                           \
+                  ".global __board_button_bit\n\t.set __board_button_bit, %c3"  \
+                  :: "n"(LedPin::port_t::letter), "n"(LedPin::bit),             \
+                     "n"(ButtonPin::port_t::letter), "n"(ButtonPin::bit))
+#else
+#define BOARD_SYMBOLS()
+#endif
+
+#endif //_BOARD_H_
@@ -0,0 +1,32 @@
+#
+# Prints FLASH and SRAM usage of the built application against the
+# budget of the selected MCU, and fails the build if either is exceeded.
+# The .hex and .eep files depend on the check, so an image over budget is
+# never written and cannot be flashed with 'make avrdude'. 'make budgets'
+# in src/ checks the ATtiny45, ATtiny13A and ATtiny2313A builds in turn.
+#
+#    FLASH_SIZE                - FLASH size of the target MCU in bytes
+#    SRAM_SIZE                 - SRAM size of the target MCU in bytes
+#    STACK_RESERVE             - SRAM that must stay free for the stack,
+#                                see tools/stackreport.sh for the real depth
+#
+
+STACK_RESERVE      ?= 24
+
+budget: $(TARGET).elf
+	@echo ' [BUDGET]  :' Checking \"$<\" against $(FLASH_SIZE) B FLASH and $(SRAM_SIZE) B SRAM
+	@$(CROSS)-size -A $< | awk -v flash=$(FLASH_SIZE) -v sram=$(SRAM_SIZE) -v stack=$(STACK_RESERVE) ' \
+		$$1 == ".text" || $$1 == ".data" { f += $$2 } \
+		$$1 == ".data" || $$1 == ".bss" || $$1 == ".noinit" { r += $$2 } \
+		END { \
+			printf "   FLASH: %5d / %5d bytes (%.1f%%)\n", f, flash, 100 * f / flash; \
+			printf "   SRAM:  %5d / %5d bytes (%.1f%%), %d left for stack\n", r, sram, 100 * r / sram, sram - r; \
+			if (f > flash) printf "   error: FLASH over budget by %d bytes\n", f - flash; \
+			if (sram - r < stack) printf "   error: less than the %d byte stack reserve left\n", stack; \
+			exit (f > flash || sram - r < stack) }'
+
+$(TARGET).hex $(TARGET).eep: budget
+
+all: budget
+
+.PHONY: budget
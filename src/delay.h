@@ -0,0 +1,168 @@
+#ifndef _DELAY_H_
+#define _DELAY_H_
+
+#include <stdint.h>
+
+// Compile-time planned busy waits. delay_us(US) converts US to CPU cycles at
+// F_CPU and spends exactly that many cycles, register loads included, using
+// the cheapest loop that reaches:
+//
+//    LOOP1       dec/brne, 3 cycles a turn, up to 256 turns
+//    LOOP2       sbiw/brne, 4 cycles a turn, up to 65535 turns
+//    CHAINED     LOOP2 inside a dec/brne loop, up to 256 times, then a tail
+//
+// Whatever is left over is padded with nops. A delay fails to compile when it
+// rounds to no cycles, when rounding to whole cycles is off by more than
+// DELAY_TOLERANCE_PPM, or when it is longer than DELAY_MAX_CYCLES.
+// tools/delayreport prints the plan and the achieved error for a range of
+// clocks.
+
+#ifndef DELAY_TOLERANCE_PPM
+#define DELAY_TOLERANCE_PPM                 10000       // 1 %
+#endif
+
+#define DELAY_LOOP1_MAX                     (3UL * 256 + 2)
+#define DELAY_LOOP2_MAX                     (4UL * 65535 + 1 + 3)
+#define DELAY_CHAINED_TURN                  (4UL * 65535 + 3)
+#define DELAY_MAX_CYCLES                    (256UL * DELAY_CHAINED_TURN + 2 + DELAY_LOOP2_MAX)
+
+#ifdef __AVR__
+#ifdef _USE_UTIL_DELAY
+#include <util/delay_basic.h>
+#else
+static inline void _delay_loop_1(uint8_t __count) __attribute__((always_inline));
+static inline void _delay_loop_2(uint16_t __count) __attribute__((always_inline));
+
+void _delay_loop_1(uint8_t __count) {
+    __asm__ volatile (
+        "1: dec %0" "\n\t"
+        "brne 1b"
+            : "=r" (__count)
+            : "0" (__count)
+    );
+}
+
+void _delay_loop_2(uint16_t __count) {
+    __asm__ volatile (
+        "1: sbiw %0,1" "\n\t"
+        "brne 1b"
+            : "=w" (__count)
+            : "0" (__count)
+    );
+}
+#endif //_USE_UTIL_DELAY
+
+static inline void _delay_loop_chained(uint8_t __outer, uint16_t __inner) __attribute__((always_inline));
+void _delay_loop_chained(uint8_t __outer, uint16_t __inner) {
+    uint16_t __count;
+    __asm__ volatile (
+        "1: movw %A1,%A2" "\n\t"
+        "2: sbiw %1,1" "\n\t"
+        "brne 2b" "\n\t"
+        "dec %0" "\n\t"
+        "brne 1b"
+            : "=r" (__outer), "=&w" (__count)
+            : "r" (__inner), "0" (__outer)
+    );
+}
+#else
+// host builds provide these, see host/
+void _delay_loop_1(uint8_t __count);
+void _delay_loop_2(uint16_t __count);
+void _delay_loop_chained(uint8_t __outer, uint16_t __inner);
+#endif //__AVR__
+
+namespace delay {
+
+enum : uint8_t { NOPS, LOOP1, LOOP2, CHAINED };
+
+constexpr double exact_cycles(double us, uint32_t f_cpu) {
+    return us * (double)f_cpu / 1000000.0;
+}
+
+constexpr uint32_t cycles(double us, uint32_t f_cpu) {
+    return (uint32_t)(exact_cycles(us, f_cpu) + 0.5);
+}
+
+constexpr uint32_t error_ppm(double us, uint32_t f_cpu) {
+    return exact_cycles(us, f_cpu) <= 0 ? 1000000UL : (uint32_t)(
+        (cycles(us, f_cpu) > exact_cycles(us, f_cpu) ?
+            cycles(us, f_cpu) - exact_cycles(us, f_cpu) :
+            exact_cycles(us, f_cpu) - cycles(us, f_cpu))
+        * 1000000.0 / exact_cycles(us, f_cpu) + 0.5);
+}
+
+constexpr uint8_t kind(uint32_t n) {
+    return n < 3 ? NOPS : n <= DELAY_LOOP1_MAX ? LOOP1 : n <= DELAY_LOOP2_MAX ? LOOP2 : CHAINED;
+}
+
+// LOOP1 costs ldi + 3 * turns - 1
+constexpr uint16_t loop1_turns(uint32_t n) {
+    return n / 3 > 256 ? 256 : n / 3;
+}
+
+// LOOP2 costs 2 * ldi + 4 * turns - 1
+constexpr uint16_t loop2_turns(uint32_t n) {
+    return (n - 1) / 4 > 65535 ? 65535 : (n - 1) / 4;
+}
+
+// CHAINED costs 3 * ldi + outer * (4 * inner + 3) - 1
+constexpr uint16_t chained_outer(uint32_t n) {
+    return (n - 2) / DELAY_CHAINED_TURN > 256 ? 256 : (n - 2) / DELAY_CHAINED_TURN;
+}
+
+constexpr uint16_t chained_inner(uint32_t n) {
+    return chained_outer(n) == 0 ? 0 :
+           ((n - 2) / chained_outer(n) - 3) / 4 > 65535 ? 65535 :
+           ((n - 2) / chained_outer(n) - 3) / 4;
+}
+
+// cycles left over for the nops, or for the tail of a CHAINED delay
+constexpr uint32_t rest(uint32_t n) {
+    return kind(n) == NOPS ? n :
+           kind(n) == LOOP1 ? n - 3 * loop1_turns(n) :
+           kind(n) == LOOP2 ? n - 4 * loop2_turns(n) - 1 :
+           n - chained_outer(n) * (4UL * chained_inner(n) + 3) - 2;
+}
+
+
+template <uint32_t N>
+static inline __attribute__((always_inline)) void nops() {
+    __asm__ volatile ("nop");
+    nops<N - 1>();
+}
+
+template <>
+inline __attribute__((always_inline)) void nops<0>() {}
+
+template <uint32_t N>
+static inline __attribute__((always_inline)) void cycles() {
+    static_assert(N <= DELAY_MAX_CYCLES, "delay too long for the chained loop");
+    if (kind(N) == LOOP1) {
+        _delay_loop_1((uint8_t)loop1_turns(N));
+    } else if (kind(N) == LOOP2) {
+        _delay_loop_2(loop2_turns(N));
+    } else if (kind(N) == CHAINED) {
+        _delay_loop_chained((uint8_t)chained_outer(N), chained_inner(N));
+        cycles<kind(N) == CHAINED ? rest(N) : 0>();
+        return;
+    }
+    nops<kind(N) == CHAINED ? 0 : rest(N)>();
+}
+
+template <>
+inline __attribute__((always_inline)) void cycles<0>() {}
+
+} // namespace delay
+
+#define DELAY_CYCLES(US)                    delay::cycles((US), F_CPU)
+
+#define delay_us(US)                                                            \
+    do {                                                                        \
+        static_assert(DELAY_CYCLES(US) > 0, "delay shorter than one cycle");    \
+        static_assert(delay::error_ppm((US), F_CPU) <= DELAY_TOLERANCE_PPM,     \
+                      "delay not representable in whole cycles at F_CPU");      \
+        delay::cycles<DELAY_CYCLES(US)>();                                      \
+    } while (0)
+
+#endif //_DELAY_H_
@@ -0,0 +1,40 @@
+#ifndef _AVR_EEPROM_H_
+#define _AVR_EEPROM_H_
+
+// EEMEM variables are plain host globals; the accessors count the cells
+// actually written so runs can be compared by EEPROM wear and energy
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../mcu.h"
+
+#define EEMEM                               __attribute__((section("eeprom")))  // kept over a reset
+
+static inline uint8_t eeprom_read_byte(const uint8_t* addr) {
+    return *addr;
+}
+
+static inline void eeprom_write_byte(uint8_t* addr, uint8_t value) {
+    host::eeprom_write(1);
+    *addr = value;
+}
+
+static inline void eeprom_update_byte(uint8_t* addr, uint8_t value) {
+    if (*addr != value) {
+        eeprom_write_byte(addr, value);
+    }
+}
+
+static inline void eeprom_read_block(void* dst, const void* src, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        ((uint8_t*)dst)[i] = ((const uint8_t*)src)[i];
+    }
+}
+
+static inline void eeprom_update_block(const void* src, void* dst, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        eeprom_update_byte((uint8_t*)dst + i, ((const uint8_t*)src)[i]);
+    }
+}
+
+#endif //_AVR_EEPROM_H_
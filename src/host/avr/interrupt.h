@@ -0,0 +1,15 @@
+#ifndef _AVR_INTERRUPT_H_
+#define _AVR_INTERRUPT_H_
+
+#include "../mcu.h"
+
+#define ISR(vector, ...)                    extern "C" void vector(void)
+#define EMPTY_INTERRUPT(vector)             extern "C" void vector(void) {}
+#define ISR_NOBLOCK
+#define ISR_NAKED
+#define reti()                              return
+
+#define sei()                               host::sei()
+#define cli()                               host::cli()
+
+#endif //_AVR_INTERRUPT_H_
@@ -0,0 +1,22 @@
+#ifndef _AVR_IO_H_
+#define _AVR_IO_H_
+
+// Host stand-in for <avr/io.h>: the real ATtiny45 register map, with every
+// I/O register backed by a host::reg that reports reads and writes to the
+// simulated MCU in mcu.cpp
+
+#include <stdint.h>
+#include "../mcu.h"
+
+#define _BV(bit)                            (1 << (bit))
+#define _SFR_IO8(addr)                      (host::io[(addr)])
+#define _SFR_MEM8(addr)                     (host::io[(addr) - 0x20])
+#define _SFR_IO16(addr)                     (host::io16[(addr)])
+#define _VECTOR(n)                          __vector_ ## n
+
+#include "../../test/iotnx5.h"
+
+#define RAMEND                              0x15F
+#define E2END                               0xFF
+
+#endif //_AVR_IO_H_
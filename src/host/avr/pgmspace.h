@@ -0,0 +1,10 @@
+#ifndef _AVR_PGMSPACE_H_
+#define _AVR_PGMSPACE_H_
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(addr)                 (*(const uint8_t*)(addr))
+#define pgm_read_word(addr)                 (*(const uint16_t*)(addr))
+
+#endif //_AVR_PGMSPACE_H_
@@ -0,0 +1,13 @@
+#ifndef _AVR_POWER_H_
+#define _AVR_POWER_H_
+
+#define power_adc_disable()                 (PRR |= _BV(PRADC))
+#define power_adc_enable()                  (PRR &= ~_BV(PRADC))
+#define power_timer0_disable()              (PRR |= _BV(PRTIM0))
+#define power_timer0_enable()               (PRR &= ~_BV(PRTIM0))
+#define power_timer1_disable()              (PRR |= _BV(PRTIM1))
+#define power_timer1_enable()               (PRR &= ~_BV(PRTIM1))
+#define power_usi_disable()                 (PRR |= _BV(PRUSI))
+#define power_usi_enable()                  (PRR &= ~_BV(PRUSI))
+
+#endif //_AVR_POWER_H_
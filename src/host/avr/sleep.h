@@ -0,0 +1,16 @@
+#ifndef _AVR_SLEEP_H_
+#define _AVR_SLEEP_H_
+
+#include "../mcu.h"
+
+#define SLEEP_MODE_IDLE                     0
+#define SLEEP_MODE_ADC                      _BV(SM0)
+#define SLEEP_MODE_PWR_DOWN                 _BV(SM1)
+
+#define set_sleep_mode(mode)                (MCUCR = (MCUCR & ~(_BV(SM0) | _BV(SM1))) | (mode))
+#define sleep_enable()                      (MCUCR |= _BV(SE))
+#define sleep_disable()                     (MCUCR &= ~_BV(SE))
+#define sleep_bod_disable()                 ((void)0)
+#define sleep_cpu()                         host::sleep()
+
+#endif //_AVR_SLEEP_H_
@@ -0,0 +1,264 @@
+// Energy model and battery-life estimator for the power traces written by
+// 'timelapse --trace'.
+//
+// Every trace line is a stretch of constant power state; its charge is the
+// sum of the currents of currents.cfg that apply to it. The steady-state
+// figures are taken between the first and the last shot, so button setup and
+// the display timeout after it do not count against the interval; the IR,
+// display and EEPROM shares are of the whole trace.
+//
+// Usage: energy [--currents FILE] DIR
+//        energy [--currents FILE] --compare BASE_DIR DIR
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define NS_PER_S                            1e9
+#define HOURS_PER_DAY                       24
+
+struct currents {
+    double power_down_uA;
+    double awake_uA;
+    double idle_uA;
+    double wdt_uA;
+    double shift_register_uA;
+    double segment_uA;
+    double ir_led_uA;
+    double eeprom_write_uA;
+    double eeprom_write_ms;
+    double battery_mAh;
+};
+
+static const struct {
+    const char* name;
+    double currents::*field;
+} keys[] = {
+    { "power_down_uA",          &currents::power_down_uA },
+    { "awake_uA",               &currents::awake_uA },
+    { "idle_uA",                &currents::idle_uA },
+    { "wdt_uA",                 &currents::wdt_uA },
+    { "shift_register_uA",      &currents::shift_register_uA },
+    { "segment_uA",             &currents::segment_uA },
+    { "ir_led_uA",              &currents::ir_led_uA },
+    { "eeprom_write_uA",        &currents::eeprom_write_uA },
+    { "eeprom_write_ms",        &currents::eeprom_write_ms },
+    { "battery_mAh",            &currents::battery_mAh },
+};
+#define KEYS                                (sizeof(keys) / sizeof(keys[0]))
+
+struct report {
+    std::string setting;
+    size_t frames = 0;
+    double total_s = 0;
+    double total_uC = 0;
+    double steady_s = 0;                    // first to last shot
+    double steady_uC = 0;
+    double ir_uC = 0;
+    double display_uC = 0;
+    double eeprom_uC = 0;
+
+    double average_uA() const {
+        return steady_s > 0 ? steady_uC / steady_s : total_uC / total_s;
+    }
+    double per_frame_uAh() const {
+        return frames > 1 ? steady_uC / (frames - 1) / 3600 : 0;
+    }
+};
+
+static bool load_currents(const char* path, currents& c) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    unsigned seen = 0;
+    char line[256];
+    for (unsigned n = 1; fgets(line, sizeof(line), f); n++) {
+        *strchrnul(line, '#') = 0;
+        char key[64];
+        double value;
+        int fields = sscanf(line, "%63s %lf", key, &value);
+        if (fields <= 0) {
+            continue;
+        }
+        unsigned k = 0;
+        while (k < KEYS && strcmp(keys[k].name, key)) {
+            k++;
+        }
+        if (fields != 2 || k == KEYS) {
+            fprintf(stderr, "%s:%u: expected '<key> <value>' with a known key\n", path, n);
+            fclose(f);
+            return false;
+        }
+        c.*keys[k].field = value;
+        seen |= 1u << k;
+    }
+    fclose(f);
+    for (unsigned k = 0; k < KEYS; k++) {
+        if (!(seen & (1u << k))) {
+            fprintf(stderr, "%s: %s missing\n", path, keys[k].name);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool load_trace(const std::string& path, const currents& c, report& r) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) {
+        perror(path.c_str());
+        return false;
+    }
+    struct stretch {
+        unsigned long long start_ns;
+        double uC;
+    };
+    std::vector<stretch> stretches;
+    std::vector<unsigned long long> shots;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long start_ns, length_ns, ir_ns;
+        char cpu;
+        unsigned wdt, lit, cells;
+        if (line[0] == '#') {
+            continue;
+        } else if (sscanf(line, "F %llu", &start_ns) == 1) {
+            shots.push_back(start_ns);
+        } else if (sscanf(line, "%llu %llu %c %u %u %llu %u", &start_ns, &length_ns, &cpu,
+                          &wdt, &lit, &ir_ns, &cells) == 7) {
+            double s = length_ns / NS_PER_S;
+            double ir = ir_ns / NS_PER_S * c.ir_led_uA;
+            double display = s * lit * c.segment_uA;
+            double eeprom = cells * c.eeprom_write_ms / 1000 * (c.eeprom_write_uA + c.awake_uA);
+            double cpu_uA = cpu == 'A' ? c.awake_uA : cpu == 'I' ? c.idle_uA : c.power_down_uA;
+            double uC = s * (cpu_uA + c.shift_register_uA +
+                             (wdt ? c.wdt_uA : 0)) + ir + display + eeprom;
+            stretches.push_back({ start_ns, uC });
+            r.total_s = (start_ns + length_ns) / NS_PER_S;
+            r.total_uC += uC;
+            r.ir_uC += ir;
+            r.display_uC += display;
+            r.eeprom_uC += eeprom;
+        } else {
+            fprintf(stderr, "%s: bad line: %s", path.c_str(), line);
+            fclose(f);
+            return false;
+        }
+    }
+    fclose(f);
+    r.frames = shots.size();
+    if (shots.size() > 1) {
+        r.steady_s = (shots.back() - shots.front()) / NS_PER_S;
+        for (const stretch& s : stretches) {
+            if (s.start_ns >= shots.front() && s.start_ns < shots.back()) {
+                r.steady_uC += s.uC;
+            }
+        }
+    }
+    return r.total_s > 0;
+}
+
+// set-<digit>.trace files of DIR, in setting order
+static bool load_dir(const char* dir, const currents& c, std::vector<report>& reports) {
+    DIR* d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        return false;
+    }
+    std::vector<std::string> names;
+    while (struct dirent* e = readdir(d)) {
+        if (!strncmp(e->d_name, "set-", 4) && strstr(e->d_name, ".trace")) {
+            names.push_back(e->d_name);
+        }
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    for (const std::string& name : names) {
+        report r;
+        r.setting = name.substr(4, name.find('.') - 4);
+        if (!load_trace(std::string(dir) + "/" + name, c, r)) {
+            return false;
+        }
+        reports.push_back(r);
+    }
+    if (reports.empty()) {
+        fprintf(stderr, "%s: no set-*.trace files\n", dir);
+        return false;
+    }
+    return true;
+}
+
+static double days(const currents& c, double uA) {
+    return c.battery_mAh * 1000 / uA / HOURS_PER_DAY;
+}
+
+static void print(const currents& c, const std::vector<report>& reports) {
+    printf("%-3s %8s %10s %10s %10s %9s %9s %9s %8s\n", "set", "frames", "hours", "avg uA",
+           "uAh/frame", "ir %", "display %", "eeprom %", "days");
+    for (const report& r : reports) {
+        double uA = r.average_uA();
+        printf("%-3s %8zu %10.2f %10.3f %10.4f %9.2f %9.2f %9.2f %8.0f\n", r.setting.c_str(),
+               r.frames, r.total_s / 3600, uA, r.per_frame_uAh(), r.ir_uC / r.total_uC * 100,
+               r.display_uC / r.total_uC * 100, r.eeprom_uC / r.total_uC * 100, days(c, uA));
+    }
+}
+
+static void compare(const currents& c, const std::vector<report>& base,
+                    const std::vector<report>& reports) {
+    printf("%-3s %10s %10s %8s %10s %10s %8s\n", "set", "base uA", "uA", "delta %",
+           "base days", "days", "delta");
+    for (const report& r : reports) {
+        auto b = std::find_if(base.begin(), base.end(),
+                              [&](const report& x) { return x.setting == r.setting; });
+        if (b == base.end()) {
+            printf("%-3s %10s %10.3f\n", r.setting.c_str(), "-", r.average_uA());
+            continue;
+        }
+        double was = b->average_uA(), is = r.average_uA();
+        printf("%-3s %10.3f %10.3f %+8.2f %10.0f %10.0f %+8.0f\n", r.setting.c_str(), was, is,
+               (is - was) / was * 100, days(c, was), days(c, is), days(c, is) - days(c, was));
+    }
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [--currents FILE] [--compare BASE_DIR] DIR\n", name);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    const char* currents_file = "currents.cfg";
+    const char* base_dir = NULL;
+    const char* dir = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--currents") && i + 1 < argc) {
+            currents_file = argv[++i];
+        } else if (!strcmp(argv[i], "--compare") && i + 1 < argc) {
+            base_dir = argv[++i];
+        } else if (!dir && argv[i][0] != '-') {
+            dir = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!dir) {
+        usage(argv[0]);
+    }
+
+    currents c;
+    std::vector<report> reports, base;
+    if (!load_currents(currents_file, c) || !load_dir(dir, c, reports) ||
+        (base_dir && !load_dir(base_dir, c, base))) {
+        return 1;
+    }
+    if (base_dir) {
+        compare(c, base, reports);
+    } else {
+        print(c, reports);
+    }
+    return 0;
+}
@@ -0,0 +1,203 @@
+// Power-leak checker for the mode state machine in main.cpp.
+//
+// Drives button timings through the firmware, first every sequence of up to
+// --depth presses over a grid of gaps and holds, then --cases random
+// sequences, and runs each until SETTLE_MS after the last release. By then
+// the device must be asleep with the display dark, and either fully powered
+// down (WDT off) or running a program (WDT at a program period of 1 sec or
+// more). The first sequence that ends anywhere else is shrunk, by dropping
+// presses and shortening gaps and holds while it still fails, and printed.
+//
+// Usage: leaks VARIANT [--depth N] [--cases N] [--seed N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "mcu.h"
+
+#define QUARTER_MS                          250         // WDT_DEFAULT tick
+#define SETTLE_TICKS                        80
+#define SETTLE_MS                           (SETTLE_TICKS * QUARTER_MS)
+#define PROGRAM_PRESCALER                   6           // 1 sec, the shortest program tick
+#define MAX_PRESSES                         24          // enough to wrap the 18 settings
+
+struct press {
+    uint32_t gap_ms;                        // from the previous release, or power-on
+    uint32_t hold_ms;
+};
+
+typedef std::vector<press> sequence;
+
+// around the 0.25 sec display ticks, the 5 sec blink and the 5 sec count,
+// the 2 sec trace hold and the 2 sec peek
+static const uint32_t grid_gaps[] = { 100, 600, 2100, 5100, 10300, 30000 };
+static const uint32_t grid_holds[] = { 100, 2600, 12000 };
+
+static uint32_t _rng = 1;
+
+static uint32_t next_random() {
+    // xorshift32
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return _rng;
+}
+
+static uint32_t between(uint32_t lo, uint32_t hi) {
+    return lo + next_random() % (hi - lo + 1);
+}
+
+// mostly quick presses, sometimes a pause for the display or a long hold
+static sequence random_sequence() {
+    sequence s(between(1, MAX_PRESSES));
+    for (press& p : s) {
+        uint32_t r = next_random() % 8;
+        p.gap_ms = r < 5 ? between(20, 800) : r < 7 ? between(800, 12000) : between(12000, 60000);
+        p.hold_ms = next_random() % 6 ? between(20, 400) : between(400, 15000);
+    }
+    return s;
+}
+
+// empty when the run ends in a valid state, else what is wrong
+static std::string check(const sequence& s) {
+    uint64_t at = 0;
+    for (const press& p : s) {
+        at += p.gap_ms;
+        host::press(at, p.hold_ms);
+        at += p.hold_ms;
+    }
+    host::stats result;
+    bool ok = host::run(at + SETTLE_MS, result);
+    host::clear_events();
+    if (!ok) {
+        return "firmware crashed";
+    }
+    char what[96];
+    if (result.end_lit) {
+        snprintf(what, sizeof(what), "display left on, %u segments lit", result.end_lit);
+        return what;
+    }
+    if (result.end_wdt && result.end_wdt_prescaler < PROGRAM_PRESCALER) {
+        snprintf(what, sizeof(what), "WDT left running at %u ms with the display dark",
+                 16 << result.end_wdt_prescaler);
+        return what;
+    }
+    return "";
+}
+
+static uint32_t shorter(uint32_t ms) {
+    return ms > 100 ? (ms / 2 + 99) / 100 * 100 : ms > 20 ? 20 : ms;
+}
+
+// greedy: keep any single step that still fails, until none does
+static sequence shrink(sequence s) {
+    for (bool progress = true; progress;) {
+        progress = false;
+        for (size_t i = 0; i < s.size() && s.size() > 1; i++) {
+            sequence t = s;
+            t.erase(t.begin() + i);
+            if (!check(t).empty()) {
+                s = t;
+                progress = true;
+                i--;
+            }
+        }
+        for (size_t i = 0; i < s.size(); i++) {
+            for (uint32_t press::*field : { &press::gap_ms, &press::hold_ms }) {
+                while (shorter(s[i].*field) != s[i].*field) {
+                    sequence t = s;
+                    t[i].*field = shorter(s[i].*field);
+                    if (check(t).empty()) {
+                        break;
+                    }
+                    s = t;
+                    progress = true;
+                }
+            }
+        }
+    }
+    return s;
+}
+
+static int report(const char* variant, const sequence& found) {
+    sequence s = shrink(found);
+    printf("%s: %s after\n", variant, check(s).c_str());
+    uint64_t at = 0;
+    for (const press& p : s) {
+        at += p.gap_ms;
+        printf("   press at %7llu ms, held %5u ms\n", (unsigned long long)at, p.hold_ms);
+        at += p.hold_ms;
+    }
+    return 1;
+}
+
+// every sequence of `depth` presses over the grid, odometer order
+static bool exhaustive(size_t depth, sequence& failed, unsigned& runs) {
+    const size_t gaps = sizeof(grid_gaps) / sizeof(grid_gaps[0]);
+    const size_t holds = sizeof(grid_holds) / sizeof(grid_holds[0]);
+    std::vector<size_t> digit(depth, 0);
+    for (;;) {
+        sequence s(depth);
+        for (size_t i = 0; i < depth; i++) {
+            s[i] = { grid_gaps[digit[i] % gaps], grid_holds[digit[i] / gaps] };
+        }
+        runs++;
+        if (!check(s).empty()) {
+            failed = s;
+            return false;
+        }
+        size_t i = 0;
+        while (i < depth && ++digit[i] == gaps * holds) {
+            digit[i++] = 0;
+        }
+        if (i == depth) {
+            return true;
+        }
+    }
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s VARIANT [--depth N] [--cases N] [--seed N]\n", name);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+    }
+    const char* variant = argv[1];
+    unsigned depth = 2;
+    unsigned cases = 200;
+    for (int i = 2; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+        } else if (!strcmp(argv[i], "--depth")) {
+            depth = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--cases")) {
+            cases = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed")) {
+            _rng = strtoul(argv[++i], NULL, 0) | 1;
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    unsigned runs = 0;
+    sequence failed;
+    for (unsigned d = 0; d <= depth; d++) {
+        if (!exhaustive(d, failed, runs)) {
+            return report(variant, failed);
+        }
+    }
+    for (unsigned n = 0; n < cases; n++, runs++) {
+        sequence s = random_sequence();
+        if (!check(s).empty()) {
+            return report(variant, s);
+        }
+    }
+    printf("%s: no leak in %u sequences\n", variant, runs);
+    return 0;
+}
@@ -0,0 +1,583 @@
+#include "mcu.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include <avr/io.h>
+#include "../board.h"
+
+extern "C" void PCINT0_vect(void);
+extern "C" void WDT_vect(void);
+extern "C" void TIMER0_COMPA_vect(void);
+int firmware_main();
+
+namespace host {
+
+reg io[0x40];
+uint16_t io16[0x40];
+stats counters;
+uint32_t wake_cycles = 150;
+uint32_t idle_wake_cycles = 8;
+int32_t wdt_error_ppm = 0;
+uint32_t wdt_jitter_ppm = 0;
+uint32_t seed = 1;
+const char* trace_path = nullptr;
+
+#define REG(R)                              (&(R) - io)
+#define NEVER                               UINT64_MAX
+#define PS_PER_MS                           1000000000ULL
+#define WDT_OSC_HZ                          128000ULL
+#define BURST_GAP_PS                        (1000ULL * 1000000ULL)  // 1 ms
+#define FRAME_GAP_PS                        (50ULL * BURST_GAP_PS)
+
+struct edge {
+    uint64_t at_ps;
+    bool     pressed;
+};
+
+struct end_of_run {};
+struct wdt_reset {};
+
+static uint64_t _now_ps;
+static uint64_t _end_ps;
+static bool _sreg_i;
+static uint8_t _pins_in = 0xFF;             // external levels, buttons released
+static std::vector<edge> _edges;
+static size_t _next_edge;
+static uint64_t _hang_ps = NEVER;
+static bool _wdt_running;
+static uint64_t _wdt_start_ps;
+static uint64_t _last_ir_edge_ps;
+static uint64_t _last_frame_ps;
+static uint64_t _wdt_period_ps;
+static bool _t0_running;
+static uint64_t _t0_next_ps;                // next compare match
+static std::vector<uint64_t> _frames;
+static uint8_t _sr_shift;                   // 74HC595 shift register
+
+// power trace, see trace_path
+static FILE* _trace;
+static uint64_t _trace_start_ps;
+static bool _asleep;
+static bool _idle;
+static uint8_t _lit;
+static uint64_t _ir_on_ps;
+static uint64_t _ir_since_ps;
+static uint32_t _eeprom_cells;
+
+static uint64_t cycles_to_ps(uint64_t cycles) {
+    return cycles * 1000000000000ULL / F_CPU;
+}
+
+static uint32_t random() {
+    // xorshift32
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+// Timer0 compare period in CTC mode, from TCCR0B and OCR0A
+static uint64_t t0_period_ps() {
+    static const uint16_t prescale[] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+    return cycles_to_ps((uint64_t)prescale[TCCR0B.value & 0x07] * (OCR0A.value + 1));
+}
+
+// period of the prescaler selected in WDTCR, drawn once per period
+static uint64_t wdt_period_ps() {
+    uint8_t wdtcr = io[REG(WDTCR)].value;
+    uint8_t prescaler = (wdtcr & 0x07) | ((wdtcr & _BV(WDP3)) ? 0x08 : 0x00);
+    uint64_t nominal = (2048ULL << prescaler) * 1000000000000ULL / WDT_OSC_HZ;
+    int64_t ppm = wdt_error_ppm;
+    if (wdt_jitter_ppm) {
+        ppm += (int64_t)(random() % (2 * wdt_jitter_ppm + 1)) - wdt_jitter_ppm;
+    }
+    return nominal + (int64_t)nominal / 1000 * ppm / 1000;
+}
+
+static void trace_flush() {
+    if (!_trace) {
+        return;
+    }
+    if (PORTB.value & LedPin::mask) {
+        _ir_on_ps += _now_ps - _ir_since_ps;
+        _ir_since_ps = _now_ps;
+    }
+    if (_now_ps > _trace_start_ps || _ir_on_ps || _eeprom_cells) {
+        fprintf(_trace, "%llu %llu %c %u %u %llu %u\n",
+                (unsigned long long)(_trace_start_ps / 1000),
+                (unsigned long long)((_now_ps - _trace_start_ps) / 1000),
+                _asleep ? (_idle ? 'I' : 'S') : 'A', _wdt_running, _lit,
+                (unsigned long long)(_ir_on_ps / 1000), _eeprom_cells);
+    }
+    _trace_start_ps = _now_ps;
+    _ir_on_ps = 0;
+    _eeprom_cells = 0;
+}
+
+static uint8_t lit_segments(uint8_t outputs) {
+#ifndef _COMMON_CATODE_
+    outputs = ~outputs;
+#endif
+    return __builtin_popcount(outputs);
+}
+
+reg::operator uint8_t() const {
+    if (this == &PINB) {
+        uint8_t ddr = DDRB.value;
+        return (PORTB.value & ddr) | (_pins_in & ~ddr);
+    }
+    return value;
+}
+
+reg& reg::operator=(unsigned v) {
+    uint8_t old = value;
+    uint8_t now = (uint8_t)v;
+    if (this == &PINB) {
+        // writing ones to PINB toggles PORTB
+        PORTB = PORTB.value ^ now;
+        return *this;
+    }
+    value = now;
+    if (this == &PORTB) {
+        if (!(old & SrClockPin::mask) && (now & SrClockPin::mask)) {
+            _sr_shift = (_sr_shift << 1) | ((now & SrDataPin::mask) ? 1 : 0);
+        }
+        if (!(old & SrLatchPin::mask) && (now & SrLatchPin::mask)) {
+            counters.shifts++;
+            if (lit_segments(_sr_shift) != _lit) {
+                trace_flush();
+                _lit = lit_segments(_sr_shift);
+            }
+        }
+        if ((old ^ now) & LedPin::mask) {
+            if (_trace && (now & LedPin::mask)) {
+                _ir_since_ps = _now_ps;
+            } else if (_trace) {
+                _ir_on_ps += _now_ps - _ir_since_ps;
+            }
+            if (!counters.ir_edges || _now_ps - _last_ir_edge_ps > BURST_GAP_PS) {
+                counters.bursts++;
+                if (!counters.frames || _now_ps - _last_frame_ps > FRAME_GAP_PS) {
+                    counters.frames++;
+                    _last_frame_ps = _now_ps;
+                    _frames.push_back(_now_ps / 1000);
+                    if (_trace) {
+                        fprintf(_trace, "F %llu\n", (unsigned long long)(_now_ps / 1000));
+                    }
+                }
+            }
+            counters.ir_edges++;
+            _last_ir_edge_ps = _now_ps;
+        }
+    } else if (this == &TCCR0B || (this == &GTCCR && (now & _BV(PSR0)))) {
+        // counting from 0 with a fresh prescaler; external clocks are not modelled
+        bool running = (TCCR0B.value & 0x07) && (TCCR0B.value & 0x07) < 6;
+        if (running && (!_t0_running || this == &GTCCR)) {
+            _t0_next_ps = _now_ps + t0_period_ps();
+        }
+        _t0_running = running;
+        GTCCR.value &= ~_BV(PSR0);
+    } else if (this == &WDTCR && !(now & _BV(WDCE))) {
+        // the WDCE write only opens the timed sequence
+        bool running = now & (_BV(WDIE) | _BV(WDE));
+        if (running && !_wdt_running) {
+            _wdt_start_ps = _now_ps;
+            _wdt_period_ps = 0;
+        } else if ((old ^ now) & (_BV(WDP3) | 0x07)) {
+            _wdt_period_ps = 0;             // new prescaler, counted from the last timeout
+        }
+        if (running != _wdt_running) {
+            trace_flush();
+        }
+        _wdt_running = running;
+    }
+    return *this;
+}
+
+void sei() {
+    _sreg_i = true;
+}
+
+void cli() {
+    _sreg_i = false;
+}
+
+static uint64_t next_wdt_ps();
+
+static uint64_t next_t0_ps() {
+    return _t0_running && (TIMSK.value & _BV(OCIE0A)) ? _t0_next_ps : NEVER;
+}
+
+static uint64_t next_edge_ps() {
+    return _next_edge < _edges.size() ? _edges[_next_edge].at_ps : NEVER;
+}
+
+// a WDT timeout now: true for the interrupt, which in the interrupt and
+// reset mode clears WDIE, a reset with WDIE clear
+static bool wdt_timeout() {
+    _wdt_start_ps = _now_ps;
+    _wdt_period_ps = 0;
+    if (!(WDTCR.value & _BV(WDIE))) {
+        counters.wdt_resets++;
+        throw wdt_reset();
+    }
+    if (WDTCR.value & _BV(WDE)) {
+        WDTCR.value &= ~_BV(WDIE);
+    }
+    return true;
+}
+
+[[noreturn]] static void end_run() {
+    _now_ps = _end_ps;
+    trace_flush();
+    uint8_t wdtcr = WDTCR.value;
+    counters.end_wdt = _wdt_running && (wdtcr & _BV(WDIE));
+    counters.end_wdt_prescaler = (wdtcr & 0x07) | ((wdtcr & _BV(WDP3)) ? 0x08 : 0x00);
+    counters.end_lit = _lit;
+    throw end_of_run();
+}
+
+static void spin();
+
+// Button edges and WDT timeouts that fall into busy time: the pin changes
+// and, with interrupts on, the ISR runs as it would between two instructions
+void awake(uint64_t cycles) {
+    static bool in_isr;
+    counters.awake_cycles += cycles;
+    _now_ps += cycles_to_ps(cycles);
+    while (!in_isr && _next_edge < _edges.size() && _edges[_next_edge].at_ps <= _now_ps) {
+        const edge& e = _edges[_next_edge++];
+        uint8_t mask = ButtonPin::mask;
+        _pins_in = e.pressed ? (_pins_in & ~mask) : (_pins_in | mask);
+        if (_sreg_i && (GIMSK.value & _BV(PCIE)) && (PCMSK.value & mask)) {
+            in_isr = true;
+            PCINT0_vect();
+            in_isr = false;
+        }
+    }
+    while (!in_isr && _sreg_i && next_t0_ps() <= _now_ps) {
+        _t0_next_ps += t0_period_ps();
+        in_isr = true;
+        TIMER0_COMPA_vect();
+        in_isr = false;
+    }
+    if (!in_isr && _sreg_i && next_wdt_ps() <= _now_ps) {
+        _wdt_start_ps = _now_ps;
+        _wdt_period_ps = 0;
+        in_isr = true;
+        WDT_vect();
+        in_isr = false;
+    }
+    if (!in_isr && _hang_ps <= _now_ps) {
+        _hang_ps = NEVER;
+        spin();
+    }
+}
+
+// the firmware stuck in a loop: only the interrupts and the WDT get anywhere
+// until the end of the run; with interrupts off the WDT interrupt never runs
+static void spin() {
+    for (;;) {
+        uint64_t wdt = next_wdt_ps();
+        uint64_t next = std::min(std::min(wdt, next_edge_ps()), next_t0_ps());
+        if (next >= _end_ps || (!_sreg_i && (WDTCR.value & _BV(WDIE)))) {
+            end_run();
+        }
+        awake(next > _now_ps ? (next - _now_ps) * F_CPU / 1000000000000ULL + 1 : 1);
+        if (wdt <= _now_ps && wdt_timeout()) {
+            WDT_vect();
+        }
+    }
+}
+
+void hang(uint64_t at_ms) {
+    _hang_ps = at_ms * PS_PER_MS;
+}
+
+void eeprom_write(uint32_t cells) {
+    counters.eeprom_writes += cells;
+    _eeprom_cells += cells;
+}
+
+uint64_t now_ns() {
+    return _now_ps / 1000;
+}
+
+// the WDT counter runs freely from the last timeout, so awake time and
+// prescaler rewrites do not shift the next timeout; a new prescaler takes
+// effect for the period running since the last one
+static uint64_t next_wdt_ps() {
+    if (!_wdt_running) {
+        return NEVER;
+    }
+    if (!_wdt_period_ps) {
+        _wdt_period_ps = wdt_period_ps();
+    }
+    uint64_t elapsed = _now_ps - _wdt_start_ps;
+    return _wdt_start_ps + (elapsed / _wdt_period_ps + 1) * _wdt_period_ps;
+}
+
+void sleep() {
+    if (!(MCUCR.value & _BV(SE))) {
+        return;
+    }
+    // Timer0 only keeps running in IDLE, and waking from IDLE needs no
+    // oscillator start-up
+    bool idle = !(MCUCR.value & (_BV(SM0) | _BV(SM1)));
+    enum { BY_PIN, BY_WDT, BY_T0 } by = BY_PIN;
+    uint64_t since_ps = _now_ps;
+    trace_flush();
+    _asleep = true;
+    _idle = idle;
+    for (;;) {
+        uint64_t wdt = next_wdt_ps();
+        uint64_t t0 = idle ? next_t0_ps() : NEVER;
+        uint64_t pin = next_edge_ps();
+        uint64_t next = std::min(std::min(wdt, pin), t0);
+        // a timed IDLE wait is finished past the end, the run ends asleep
+        if ((next >= _end_ps && t0 == NEVER) || !_sreg_i) {
+            end_run();
+        }
+        _now_ps = std::max(_now_ps, next);
+        if (t0 <= wdt && t0 <= pin) {
+            _t0_next_ps += t0_period_ps();
+            by = BY_T0;
+            break;
+        }
+        if (wdt <= pin) {
+            wdt_timeout();
+            counters.wdt_wakes += !idle;
+            by = BY_WDT;
+            break;
+        }
+        const edge& e = _edges[_next_edge++];
+        uint8_t mask = ButtonPin::mask;
+        _pins_in = e.pressed ? (_pins_in & ~mask) : (_pins_in | mask);
+        if ((GIMSK.value & _BV(PCIE)) && (PCMSK.value & mask)) {
+            counters.pcint_wakes += !idle;
+            break;
+        }
+    }
+    trace_flush();
+    _asleep = false;
+    _idle = false;
+    if (idle) {
+        counters.idle_cycles += (_now_ps - since_ps) * F_CPU / 1000000000000ULL;
+        awake(idle_wake_cycles);
+    } else {
+        counters.wakes++;
+        awake(wake_cycles);
+    }
+    if (by == BY_T0) {
+        TIMER0_COMPA_vect();
+    } else if (by == BY_WDT) {
+        WDT_vect();
+    } else {
+        PCINT0_vect();
+    }
+}
+
+void press(uint64_t at_ms, uint32_t hold_ms) {
+    _edges.push_back({ at_ms * PS_PER_MS, true });
+    _edges.push_back({ (at_ms + hold_ms) * PS_PER_MS, false });
+    std::stable_sort(_edges.begin(), _edges.end(),
+                     [](const edge& a, const edge& b) { return a.at_ps < b.at_ps; });
+}
+
+void clear_events() {
+    _edges.clear();
+    _hang_ps = NEVER;
+}
+
+static bool read_all(int fd, void* buf, size_t size) {
+    for (size_t done = 0; done < size; ) {
+        ssize_t n = read(fd, (uint8_t*)buf + done, size - done);
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+static bool write_all(int fd, const void* buf, size_t size) {
+    for (size_t done = 0; done < size; ) {
+        ssize_t n = write(fd, (const uint8_t*)buf + done, size - done);
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+// What a watchdog reset hands to the boot after it: the world outside the
+// MCU, and the EEPROM and .noinit contents, which the reset leaves alone.
+// The registers and the firmware globals come fresh from the spare process.
+struct world {
+    uint64_t    now_ps;
+    stats       counters;
+    size_t      next_edge;
+    uint8_t     pins_in;
+    uint64_t    last_ir_edge_ps;
+    uint64_t    last_frame_ps;
+    uint8_t     sr_shift;
+    uint8_t     lit;
+    uint32_t    seed;
+    uint64_t    frames;
+};
+
+extern "C" uint8_t __start_noinit[] __attribute__((weak));
+extern "C" uint8_t __stop_noinit[] __attribute__((weak));
+extern "C" uint8_t __start_eeprom[] __attribute__((weak));
+extern "C" uint8_t __stop_eeprom[] __attribute__((weak));
+
+static bool send_world(int fd) {
+    world w = { _now_ps, counters, _next_edge, _pins_in, _last_ir_edge_ps, _last_frame_ps,
+                _sr_shift, _lit, seed, _frames.size() };
+    return write_all(fd, &w, sizeof(w)) &&
+           write_all(fd, _frames.data(), _frames.size() * sizeof(uint64_t)) &&
+           write_all(fd, __start_noinit, __stop_noinit - __start_noinit) &&
+           write_all(fd, __start_eeprom, __stop_eeprom - __start_eeprom);
+}
+
+static bool receive_world(int fd) {
+    world w;
+    if (!read_all(fd, &w, sizeof(w))) {
+        return false;
+    }
+    _now_ps = w.now_ps;
+    counters = w.counters;
+    _next_edge = w.next_edge;
+    _hang_ps = NEVER;                       // the hang is over
+    _pins_in = w.pins_in;
+    _last_ir_edge_ps = w.last_ir_edge_ps;
+    _last_frame_ps = w.last_frame_ps;
+    _sr_shift = w.sr_shift;
+    _lit = w.lit;
+    seed = w.seed;
+    _frames.resize(w.frames);
+    return read_all(fd, _frames.data(), w.frames * sizeof(uint64_t)) &&
+           read_all(fd, __start_noinit, __stop_noinit - __start_noinit) &&
+           read_all(fd, __start_eeprom, __stop_eeprom - __start_eeprom);
+}
+
+// Runs the firmware from power-on or reset to the end of the run, with a
+// spare copy of the process forked before it: a watchdog reset sends the
+// world to the spare, which boots again from there.
+[[noreturn]] static void boot(int out_fd) {
+    int fds[2];
+    if (pipe(fds)) {
+        _exit(1);
+    }
+    if (_trace) {
+        fflush(_trace);
+    }
+    fflush(stdout);
+    pid_t spare = fork();
+    if (spare == 0) {
+        close(fds[1]);
+        if (!receive_world(fds[0])) {
+            _exit(0);                       // no reset this time
+        }
+        close(fds[0]);
+        _trace_start_ps = _now_ps;
+        if (_trace && (fclose(_trace), !(_trace = fopen(trace_path, "a")))) {
+            perror(trace_path);
+            _exit(1);
+        }
+        MCUSR.value = _BV(WDRF);
+        WDTCR.value = _BV(WDE);             // the reset leaves the WDT on
+        _wdt_running = true;
+        _wdt_start_ps = _now_ps;
+        boot(out_fd);
+    }
+    close(fds[0]);
+    int status = 0;
+    try {
+        firmware_main();
+    } catch (const end_of_run&) {
+        close(fds[1]);
+        waitpid(spare, &status, 0);
+        if (_trace) {
+            fclose(_trace);
+        }
+        uint64_t n = _frames.size();
+        if (!write_all(out_fd, &counters, sizeof(counters)) ||
+            !write_all(out_fd, &n, sizeof(n)) ||
+            !write_all(out_fd, _frames.data(), n * sizeof(uint64_t))) {
+            _exit(1);
+        }
+        _exit(0);
+    } catch (const wdt_reset&) {
+        trace_flush();
+        if (_trace) {
+            fclose(_trace);
+        }
+        bool sent = send_world(fds[1]);
+        close(fds[1]);
+        waitpid(spare, &status, 0);
+        _exit(sent && WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+    }
+    close(fds[1]);
+    waitpid(spare, &status, 0);
+    _exit(0);
+}
+
+bool run(uint64_t duration_ms, stats& result, std::vector<uint64_t>* frames) {
+    int fds[2];
+    if (pipe(fds)) {
+        return false;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        _end_ps = duration_ms * PS_PER_MS;
+        if (trace_path && !(_trace = fopen(trace_path, "w"))) {
+            perror(trace_path);
+            _exit(1);
+        }
+        if (_trace) {
+            fprintf(_trace, "# start_ns length_ns cpu wdt lit_segments ir_on_ns eeprom_cells\n");
+        }
+        boot(fds[1]);
+    }
+    close(fds[1]);
+    memset(&result, 0, sizeof(result));
+    uint64_t n = 0;
+    std::vector<uint64_t> times;
+    bool ok = read_all(fds[0], &result, sizeof(result)) && read_all(fds[0], &n, sizeof(n));
+    if (ok) {
+        times.resize(n);
+        ok = read_all(fds[0], times.data(), n * sizeof(uint64_t));
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (frames) {
+        frames->swap(times);
+    }
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+} // namespace host
+
+// delay.h primitives, the loops only cost time here
+
+void _delay_loop_1(uint8_t count) {
+    host::awake(3ULL * (count ? count : 256));
+}
+
+void _delay_loop_2(uint16_t count) {
+    host::awake(4ULL * (count ? count : 65536));
+}
+
+void _delay_loop_chained(uint8_t outer, uint16_t inner) {
+    host::awake((outer ? outer : 256) * (4ULL * inner + 3));
+}
@@ -0,0 +1,87 @@
+#ifndef _HOST_MCU_H_
+#define _HOST_MCU_H_
+
+// Simulated ATtiny45 for the host build of main.cpp. I/O registers are
+// host::reg objects that report to mcu.cpp, and sleep_cpu() hands control to
+// the simulator, which advances virtual time to the next WDT timeout or
+// button edge and runs the matching ISR. Awake time is what the delay loops
+// spend plus wake_cycles per wake; everything else is taken as free.
+
+#include <stdint.h>
+#include <vector>
+
+namespace host {
+
+struct reg {
+    uint8_t value;
+
+    operator uint8_t() const;
+    reg& operator=(unsigned v);
+    reg& operator=(const reg& r) { return *this = (unsigned)(uint8_t)r; }
+    reg& operator|=(unsigned v) { return *this = (uint8_t)*this | v; }
+    reg& operator&=(unsigned v) { return *this = (uint8_t)*this & v; }
+    reg& operator^=(unsigned v) { return *this = (uint8_t)*this ^ v; }
+};
+
+extern reg io[0x40];
+extern uint16_t io16[0x40];
+
+struct stats {
+    uint64_t wakes;
+    uint64_t wdt_wakes;
+    uint64_t pcint_wakes;
+    uint64_t shifts;                        // 74HC595 latch pulses, one per shift()
+    uint64_t bursts;                        // IR bursts, one per send_pulses()
+    uint64_t frames;                        // bursts that start a new shot
+    uint64_t ir_edges;
+    uint64_t eeprom_writes;
+    uint64_t awake_cycles;
+    uint64_t idle_cycles;                   // IDLE sleep, Timer0 running
+    uint64_t wdt_resets;
+    // power state the run ended in, asleep
+    uint8_t end_wdt;                        // WDT interrupt enabled
+    uint8_t end_wdt_prescaler;              // period 16 ms << prescaler
+    uint8_t end_lit;                        // lit segments
+};
+
+extern stats counters;
+extern uint32_t wake_cycles;
+extern uint32_t idle_wake_cycles;
+
+// WDT oscillator model: a fixed per-chip error, plus a uniformly distributed
+// error of up to wdt_jitter_ppm drawn for every period from seed
+extern int32_t wdt_error_ppm;
+extern uint32_t wdt_jitter_ppm;
+extern uint32_t seed;
+
+void sei();
+void cli();
+void sleep();
+void awake(uint64_t cycles);
+void eeprom_write(uint32_t cells);
+uint64_t now_ns();
+
+// Power-state trace of the next run() for the energy model (energy.cpp),
+// written when set. One line per stretch of constant power state:
+//    <start ns> <length ns> <S power-down | I idle | A awake> <WDT on>
+//    <lit segments> <IR LED on ns> <EEPROM cells written>
+// plus "F <ns>" at the start of every shot.
+extern const char* trace_path;
+
+// Scenario setup, call before run(). Times are from power-on.
+void press(uint64_t at_ms, uint32_t hold_ms);
+// from at_ms the firmware spins where it is, interrupts still served, until
+// the WDT resets it or the run ends
+void hang(uint64_t at_ms);
+void clear_events();
+
+// Boots a fresh copy of the firmware in a child process, runs it for
+// duration_ms of virtual time and returns its counters, and the start of
+// every shot in ns when frames is given. A WDT reset boots the firmware
+// again within the same run, with the EEPROM and .noinit kept. Returns false
+// if the firmware crashed.
+bool run(uint64_t duration_ms, stats& result, std::vector<uint64_t>* frames = nullptr);
+
+} // namespace host
+
+#endif //_HOST_MCU_H_
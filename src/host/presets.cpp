@@ -0,0 +1,114 @@
+// Boot preset checks for the host build of main.cpp with -D_PRESET_.
+//
+// Every case writes a preset, as tools/preset would, into the EEPROM and
+// powers up: a valid one runs its setting without the display, from the
+// start delay and up to the frame limit, anything else boots to the usual
+// setup, and a button press while running gives the setup back.
+//
+// Usage: presets
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include <avr/io.h>
+#include "mcu.h"
+#include "../preset.h"
+
+#define SECOND                              1000ULL
+#define MINUTE                              (60 * SECOND)
+#define PRESS_MS                            100
+#define TOLERANCE                           0.03        // the WDT runs 2.4% long
+
+extern preset _preset;
+
+struct preset_case {
+    const char*             name;
+    uint8_t                 setting;
+    uint8_t                 protocol;
+    uint16_t                frames;
+    uint16_t                start_s;
+    uint8_t                 corrupt;                    // xor into the check
+    std::vector<uint64_t>   presses_ms;
+    uint64_t                duration_ms;
+    double                  first_ms;                   // 0 for no frames
+    double                  gap_ms;
+    size_t                  min_frames, max_frames;
+    bool                    display;                    // any shifts
+    bool                    running;                    // at the end of the run
+};
+
+static const preset_case cases[] = {
+    // 3 sec, 10 sec start delay, 5 frames
+    { "limited",  3, PRESET_INSTANT, 5,  10, 0,    { },               1 * MINUTE, 13000, 3000,  5,  5,   false, false },
+    // 1 min ticks of 4 sec, 9 sec start delay rounds up to 3 ticks
+    { "rounded",  10, PRESET_DELAYED, 2, 9,  0,    { },               3 * MINUTE, 72000, 60000, 2,  2,   false, false },
+    { "endless",  1, PRESET_INSTANT, 0,  0,  0,    { },               1 * MINUTE, 1000,  1000,  55, 61,  false, true },
+    { "corrupt",  3, PRESET_INSTANT, 5,  10, 0x01, { },               1 * MINUTE, 0,     0,     0,  0,   true,  false },
+    // peek, then the next setting, 4 sec, without the limit
+    { "pressed",  3, PRESET_INSTANT, 5,  10, 0,    { 20000, 21000 },  2 * MINUTE, 13000, 3000,  20, 40,  true,  true },
+};
+
+static bool check(const preset_case& c) {
+    _preset = preset();
+    _preset.version = PRESET_VERSION;
+    _preset.setting = c.setting;
+    _preset.protocol = c.protocol;
+    _preset.frames = c.frames;
+    _preset.start_s = c.start_s;
+    _preset.check = preset_check(_preset) ^ c.corrupt;
+    for (uint64_t at : c.presses_ms) {
+        host::press(at, PRESS_MS);
+    }
+    host::stats result;
+    std::vector<uint64_t> frames;
+    bool ok = host::run(c.duration_ms, result, &frames);
+    host::clear_events();
+    if (!ok) {
+        printf("%-12s firmware crashed\n", c.name);
+        return false;
+    }
+
+    bool passed = frames.size() >= c.min_frames && frames.size() <= c.max_frames;
+    printf("%-12s %3zu frames, expected %zu..%zu\n", c.name, frames.size(), c.min_frames, c.max_frames);
+    if (!frames.empty() && c.first_ms) {
+        double first = frames[0] / 1e6;
+        if (fabs(first - c.first_ms) > c.first_ms * TOLERANCE) {
+            printf("   first frame at %.0f ms, expected %.0f ms\n", first, c.first_ms);
+            passed = false;
+        }
+    }
+    // the gaps up to the first press, the setting changes there
+    for (size_t i = 1; i < frames.size(); i++) {
+        if (!c.presses_ms.empty() && frames[i] / 1000000 >= c.presses_ms[0]) {
+            break;
+        }
+        double gap = (frames[i] - frames[i - 1]) / 1e6;
+        if (fabs(gap - c.gap_ms) > c.gap_ms * TOLERANCE) {
+            printf("   frame %zu: %.0f ms after the last, expected %.0f ms\n", i, gap, c.gap_ms);
+            passed = false;
+        }
+    }
+    if ((result.shifts != 0) != c.display) {
+        printf("   %llu shifts\n", (unsigned long long)result.shifts);
+        passed = false;
+    }
+    if (result.end_lit) {
+        printf("   display left on\n");
+        passed = false;
+    }
+    if ((bool)result.end_wdt != c.running) {
+        printf("   WDT %s at the end\n", result.end_wdt ? "still running" : "off");
+        passed = false;
+    }
+    return passed;
+}
+
+int main() {
+    int failed = 0;
+    for (const preset_case& c : cases) {
+        failed += !check(c);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+// Warm restart checks for the host build of main.cpp with -D_WARM_RESTART_.
+//
+// Every case selects a setting, lets the program run and hangs the firmware
+// at some point, then compares the frames with the same run without the
+// hang: a program gets one watchdog reset and goes on where it was, the
+// frame the hang was due in late by up to a WDT period and every other one
+// on time, without an EEPROM write or the display. Without a program the
+// WDT only interrupts and the hang is never reset.
+//
+// Usage: restarts
+
+#include <stdio.h>
+#include <vector>
+
+#include "mcu.h"
+
+#define SECOND                              1000ULL
+#define MINUTE                              (60 * SECOND)
+#define PRESS_MS                            100
+#define PRESS_GAP_MS                        600
+#define ON_TIME_NS                          20000000ULL     // boot and resume
+#define LATE_NS                             (8 * SECOND * 1000000ULL)
+
+struct restart_case {
+    const char* name;
+    uint8_t     setting;                    // presses from one second on
+    uint64_t    hang_ms;
+    uint64_t    duration_ms;
+    uint64_t    resets;
+};
+
+static const restart_case cases[] = {
+    { "3s-early",   3,  30300,  2 * MINUTE, 1 },
+    { "3s-mid",     3,  31300,  2 * MINUTE, 1 },
+    { "3s-late",    3,  32300,  2 * MINUTE, 1 },
+    { "1m",         10, 150000, 6 * MINUTE, 1 },
+    { "setup",      3,  3000,   1 * MINUTE, 0 },
+};
+
+static void select_setting(uint8_t count) {
+    uint64_t at = SECOND;
+    for (uint8_t i = 0; i < count; i++, at += PRESS_GAP_MS) {
+        host::press(at, PRESS_MS);
+    }
+}
+
+static bool run(const restart_case& c, bool hang, host::stats& result, std::vector<uint64_t>& frames) {
+    select_setting(c.setting);
+    if (hang) {
+        host::hang(c.hang_ms);
+    }
+    bool ok = host::run(c.duration_ms, result, &frames);
+    host::clear_events();
+    if (!ok) {
+        printf("%-12s firmware crashed\n", c.name);
+    }
+    return ok;
+}
+
+static bool check(const restart_case& c) {
+    host::stats base, hung;
+    std::vector<uint64_t> base_frames, frames;
+    if (!run(c, false, base, base_frames) || !run(c, true, hung, frames)) {
+        return false;
+    }
+
+    bool passed = hung.wdt_resets == c.resets;
+    printf("%-12s %3zu frames, %3zu without the hang, %llu resets\n", c.name, frames.size(),
+           base_frames.size(), (unsigned long long)hung.wdt_resets);
+    if (!c.resets) {
+        return passed;
+    }
+    if (frames.size() != base_frames.size()) {
+        passed = false;
+    }
+    for (size_t i = 0; i < frames.size() && i < base_frames.size(); i++) {
+        uint64_t hang_ns = c.hang_ms * 1000000ULL;
+        bool due_in_hang = base_frames[i] >= hang_ns && base_frames[i] < hang_ns + LATE_NS;
+        int64_t late = (int64_t)(frames[i] - base_frames[i]);
+        if (late < -(int64_t)ON_TIME_NS || late > (int64_t)(due_in_hang ? LATE_NS : ON_TIME_NS)) {
+            printf("   frame %zu: %.0f ms late\n", i, late / 1e6);
+            passed = false;
+        }
+    }
+    if (hung.eeprom_writes != base.eeprom_writes) {
+        printf("   %llu EEPROM writes, %llu without the hang\n",
+               (unsigned long long)hung.eeprom_writes, (unsigned long long)base.eeprom_writes);
+        passed = false;
+    }
+    // the resume blanks the 74HC595 once
+    if (hung.shifts != base.shifts + c.resets) {
+        printf("   %llu shifts, %llu without the hang\n",
+               (unsigned long long)hung.shifts, (unsigned long long)base.shifts);
+        passed = false;
+    }
+    if (hung.end_lit) {
+        printf("   display left on\n");
+        passed = false;
+    }
+    if (hung.end_wdt != base.end_wdt) {
+        printf("   WDT %s at the end\n", hung.end_wdt ? "still running" : "off");
+        passed = false;
+    }
+    return passed;
+}
+
+int main() {
+    int failed = 0;
+    for (const restart_case& c : cases) {
+        failed += !check(c);
+    }
+    return failed ? 1 : 0;
+}
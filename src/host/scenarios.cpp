@@ -0,0 +1,149 @@
+// Wake-count regression scenarios for the host build of main.cpp.
+//
+// Every scenario boots the firmware, drives the button and runs it for a
+// stretch of virtual time, then compares wakes, shift() calls, IR bursts,
+// EEPROM writes, awake and IDLE cycles with the numbers recorded in
+// budget.txt. Any counter above its budget, or without one, fails the run.
+//
+// Usage: scenarios VARIANT BUDGET_FILE [--update]
+
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "mcu.h"
+
+#define SECOND                              1000ULL
+#define MINUTE                              (60 * SECOND)
+#define HOUR                                (60 * MINUTE)
+#define PRESS_MS                            100
+#define PRESS_GAP_MS                        600
+#define SETTINGS                            18
+
+struct scenario {
+    std::string name;
+    uint64_t    duration_ms;
+    host::stats result;
+};
+
+// presses the button `count` times from one second after power-on
+static uint64_t select_setting(uint8_t count) {
+    uint64_t at = SECOND;
+    for (uint8_t i = 0; i < count; i++, at += PRESS_GAP_MS) {
+        host::press(at, PRESS_MS);
+    }
+    return at;
+}
+
+static void add(std::map<std::string, scenario>& all, const std::string& name, uint64_t duration_ms) {
+    scenario& s = all[name];
+    s.name = name;
+    s.duration_ms = duration_ms;
+    if (!host::run(duration_ms, s.result)) {
+        fprintf(stderr, "%s: firmware crashed\n", name.c_str());
+        exit(1);
+    }
+    host::clear_events();
+}
+
+static std::map<std::string, scenario> run_all() {
+    std::map<std::string, scenario> all;
+    char name[32];
+
+    add(all, "boot", 1 * MINUTE);
+    for (uint8_t setting = 1; setting < SETTINGS; setting++) {
+        select_setting(setting);
+        snprintf(name, sizeof(name), "run-%02u", setting);
+        add(all, name, 1 * HOUR);
+    }
+    uint64_t at = select_setting(3);
+    host::press(at + 30 * MINUTE, PRESS_MS);
+    add(all, "press-while-running", 1 * HOUR);
+    at = select_setting(3);
+    host::press(at + 30 * MINUTE, PRESS_MS);
+    host::press(at + 30 * MINUTE + PRESS_GAP_MS, PRESS_MS);
+    add(all, "double-press-while-running", 1 * HOUR);
+    at = select_setting(3);
+    host::press(at + 30 * MINUTE, 3 * SECOND);
+    add(all, "long-press-while-running", 1 * HOUR);
+    return all;
+}
+
+#define COUNTERS(X)                                                             \
+    X(wakes) X(wdt_wakes) X(pcint_wakes) X(shifts) X(bursts) X(eeprom_writes)  \
+    X(awake_cycles) X(idle_cycles)
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s VARIANT BUDGET_FILE [--update]\n", argv[0]);
+        return 2;
+    }
+    std::string variant = argv[1];
+    const char* budget_file = argv[2];
+    bool update = argc > 3 && !strcmp(argv[3], "--update");
+
+    std::map<std::string, scenario> all = run_all();
+
+    // budget.txt: one "variant/scenario counter value" per line
+    std::map<std::string, uint64_t> budget;
+    std::map<std::string, uint64_t> records;
+    if (FILE* f = fopen(budget_file, "r")) {
+        char line[256], key[128], counter[64];
+        unsigned long long value;
+        while (fgets(line, sizeof(line), f)) {
+            if (line[0] == '#' || sscanf(line, "%127s %63s %llu", key, counter, &value) != 3) {
+                continue;
+            }
+            budget[std::string(key) + " " + counter] = value;
+            if (strncmp(key, (variant + "/").c_str(), variant.size() + 1)) {
+                records[std::string(key) + " " + counter] = value;
+            }
+        }
+        fclose(f);
+    }
+
+    int failed = 0;
+    printf("%-32s %7s %7s %7s %7s %7s %7s %12s %12s\n", "scenario", "wakes", "wdt", "pcint",
+           "shifts", "bursts", "eeprom", "awake cyc", "idle cyc");
+    for (const auto& it : all) {
+        const scenario& s = it.second;
+        std::string key = variant + "/" + s.name;
+        printf("%-32s %7llu %7llu %7llu %7llu %7llu %7llu %12llu %12llu\n", key.c_str(),
+               (unsigned long long)s.result.wakes, (unsigned long long)s.result.wdt_wakes,
+               (unsigned long long)s.result.pcint_wakes, (unsigned long long)s.result.shifts,
+               (unsigned long long)s.result.bursts, (unsigned long long)s.result.eeprom_writes,
+               (unsigned long long)s.result.awake_cycles, (unsigned long long)s.result.idle_cycles);
+#define CHECK(C)                                                                \
+        {                                                                       \
+            auto b = budget.find(key + " " #C);                                 \
+            if (!update && b == budget.end()) {                                 \
+                printf("   no budget for %s %s\n", key.c_str(), #C);            \
+                failed++;                                                       \
+            } else if (!update && s.result.C > b->second) {                     \
+                printf("   %s went up: %llu > %llu\n", #C,                      \
+                       (unsigned long long)s.result.C,                          \
+                       (unsigned long long)b->second);                          \
+                failed++;                                                       \
+            }                                                                   \
+            records[key + " " #C] = s.result.C;                                \
+        }
+        COUNTERS(CHECK)
+#undef CHECK
+    }
+
+    if (update) {
+        FILE* f = fopen(budget_file, "w");
+        if (!f) {
+            perror(budget_file);
+            return 2;
+        }
+        fprintf(f, "# Written by 'make -C src/host update-budget', checked by 'make -C src/host check'\n");
+        for (const auto& r : records) {
+            fprintf(f, "%s %llu\n", r.first.c_str(), (unsigned long long)r.second);
+        }
+        fclose(f);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+// Shooting sequence checks for the host build of main.cpp with -D_SEQUENCE_.
+//
+// Every case assembles a program with tools/seqasm.h, or takes the raw
+// bytes seqasm would refuse, into the EEPROM sequence, selects 'P' with the button, and compares the frames taken with
+// the gaps expected from the source, to within the WDT's nominal error, and
+// the power state the run ended in.
+//
+// Usage: sequences
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include <avr/io.h>
+#include "mcu.h"
+#include "../tools/seqasm.h"
+
+#define SECOND                              1000ULL
+#define MINUTE                              (60 * SECOND)
+#define PRESS_MS                            100
+#define PRESS_GAP_MS                        600
+#define SEQUENCE_SETTING                    18          // after 0..h
+#define TOLERANCE                           0.03        // the WDT runs 2.4% long
+
+extern uint8_t _sequence[];
+
+struct sequence_case {
+    const char*             name;
+    const char*             source;
+    uint64_t                duration_ms;
+    std::vector<double>     gaps_ms;                    // between frames
+    bool                    running;                    // at the end of the run
+    std::vector<uint8_t>    raw;                        // instead of source
+};
+
+static const sequence_case cases[] = {
+    {
+        "bracket",
+        "again:  set 0 3\n"
+        "frame:  shoot\n"
+        "        wait 2s\n"
+        "        loop 0 frame\n"
+        "        wait 1m\n"
+        "        set 1 2\n"
+        "bracket: shoot\n"
+        "        wait 500ms\n"
+        "        loop 1 bracket\n"
+        "        until 9 again\n"
+        "        end\n",
+        5 * MINUTE,
+        { 2000, 2000, 62000, 500, 500, 2000, 2000, 62000, 500 },
+        false
+    },
+    {
+        "bulb",
+        "bulb 5s\n"
+        "end\n",
+        1 * MINUTE,
+        { 5000 },
+        false
+    },
+    {
+        "forever",
+        "frame: wait 1h\n"
+        "       shoot\n"
+        "       jump frame\n",
+        3 * 60 * MINUTE,
+        { 60 * MINUTE },
+        true
+    },
+    {
+        // never waits, runs SEQUENCE_STEPS instructions per tick
+        "spin",
+        "spin: jump spin\n",
+        1 * MINUTE,
+        { },
+        true
+    },
+    {
+        "erased",
+        "",
+        1 * MINUTE,
+        { },
+        false
+    },
+    {
+        // a 64 ms wait the program tick cannot time, the shot is never taken
+        "short-wait",
+        NULL,
+        1 * MINUTE,
+        { },
+        false,
+        { SEQ_WAIT | 4, 1, SEQ_WAIT | 2, 3, SEQ_SHOOT, SEQ_END }
+    },
+    {
+        // a reserved WDT prescaler, the bulb is never opened
+        "long-bulb",
+        NULL,
+        1 * MINUTE,
+        { },
+        false,
+        { SEQ_BULB | 10, 1, SEQ_END }
+    },
+};
+
+static bool check(const sequence_case& c) {
+    std::vector<uint8_t> code = c.raw;
+    std::string error;
+    if (c.source && !seq_assemble(c.source, code, error)) {
+        printf("%-12s %s\n", c.name, error.c_str());
+        return false;
+    }
+    memset(_sequence, SEQ_END, SEQUENCE_SIZE);
+    memcpy(_sequence, code.data(), code.size());
+    for (uint8_t i = 0; i < SEQUENCE_SETTING; i++) {
+        host::press(SECOND + i * PRESS_GAP_MS, PRESS_MS);
+    }
+    host::stats result;
+    std::vector<uint64_t> frames;
+    bool ok = host::run(c.duration_ms, result, &frames);
+    host::clear_events();
+    if (!ok) {
+        printf("%-12s firmware crashed\n", c.name);
+        return false;
+    }
+
+    bool passed = frames.size() == c.gaps_ms.size() + (c.gaps_ms.empty() ? 0 : 1);
+    printf("%-12s %3zu frames, expected %zu\n", c.name, frames.size(),
+           c.gaps_ms.size() + (c.gaps_ms.empty() ? 0 : 1));
+    for (size_t i = 1; i < frames.size() && i <= c.gaps_ms.size(); i++) {
+        double gap = (frames[i] - frames[i - 1]) / 1e6;
+        double expected = c.gaps_ms[i - 1];
+        if (fabs(gap - expected) > expected * TOLERANCE) {
+            printf("   frame %zu: %.0f ms after the last, expected %.0f ms\n", i, gap, expected);
+            passed = false;
+        }
+    }
+    if (result.end_lit) {
+        printf("   display left on\n");
+        passed = false;
+    }
+    if ((bool)result.end_wdt != c.running) {
+        printf("   WDT %s at the end\n", result.end_wdt ? "still running" : "off");
+        passed = false;
+    }
+    return passed;
+}
+
+int main() {
+    int failed = 0;
+    for (const sequence_case& c : cases) {
+        failed += !check(c);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,138 @@
+// Virtual-time timelapse session simulator.
+//
+// Selects each interval setting with button presses, lets the firmware run
+// a multi-day session against the modeled WDT, and reports for every
+// durations[] entry the frame count, the cadence against the nominal interval
+// of cycles.md, and the interval jitter. --trace writes the power trace of
+// every setting to DIR/set-<digit>.trace for energy.cpp.
+//
+// Usage: timelapse [--days N] [--wdt-error PPM] [--jitter PPM] [--seed N]
+//                  [--setting K] [--frames FILE] [--trace DIR]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "mcu.h"
+
+#define SECOND                              1000ULL
+#define DAY                                 (24 * 60 * 60 * SECOND)
+#define NS_PER_S                            1e9
+#define PRESS_MS                            100
+#define PRESS_GAP_MS                        600
+
+// cycles.md, in seconds; 0 is "disabled"
+static const double nominal[] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 60, 120, 180, 240, 300, 360, 420, 480
+};
+#define SETTINGS                            (sizeof(nominal) / sizeof(nominal[0]))
+
+static const char digits[] = "0123456789abcdefgh";
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [--days N] [--wdt-error PPM] [--jitter PPM] [--seed N] "
+                    "[--setting K] [--frames FILE] [--trace DIR]\n", name);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    double days = 7;
+    int only = -1;
+    const char* frames_file = NULL;
+    const char* trace_dir = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+        } else if (!strcmp(argv[i], "--days")) {
+            days = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--wdt-error")) {
+            host::wdt_error_ppm = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--jitter")) {
+            host::wdt_jitter_ppm = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed")) {
+            host::seed = strtoul(argv[++i], NULL, 0) | 1;
+        } else if (!strcmp(argv[i], "--setting")) {
+            only = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--frames")) {
+            frames_file = argv[++i];
+        } else if (!strcmp(argv[i], "--trace")) {
+            trace_dir = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    FILE* csv = NULL;
+    if (frames_file) {
+        if (!(csv = fopen(frames_file, "w"))) {
+            perror(frames_file);
+            return 2;
+        }
+        fprintf(csv, "setting,frame,time_s\n");
+    }
+
+    printf("%.1f day session, WDT error %d ppm, jitter +-%u ppm\n\n", days,
+           host::wdt_error_ppm, host::wdt_jitter_ppm);
+    printf("%-3s %9s %9s %8s %10s %11s %10s %10s %10s %10s\n", "set", "nominal s", "frames",
+           "per 24h", "mean s", "drift ppm", "jitter ms", "min s", "max s", "lag s");
+
+    for (unsigned setting = 1; setting < SETTINGS; setting++) {
+        if (only >= 0 && (unsigned)only != setting) {
+            continue;
+        }
+        uint64_t at = SECOND;
+        for (unsigned i = 0; i < setting; i++, at += PRESS_GAP_MS) {
+            host::press(at, PRESS_MS);
+        }
+        std::string trace;
+        if (trace_dir) {
+            trace = std::string(trace_dir) + "/set-" + digits[setting] + ".trace";
+            host::trace_path = trace.c_str();
+        }
+        host::stats result;
+        std::vector<uint64_t> frames;
+        if (!host::run((uint64_t)(days * DAY), result, &frames)) {
+            fprintf(stderr, "setting %c: firmware crashed\n", digits[setting]);
+            return 1;
+        }
+        host::clear_events();
+
+        size_t n = frames.size();
+        size_t per_day = 0;
+        double sum = 0, sum2 = 0, lo = 0, hi = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (frames[i] - frames[0] < DAY * 1000000ULL) {
+                per_day++;
+            }
+            if (csv) {
+                fprintf(csv, "%c,%zu,%.6f\n", digits[setting], i, frames[i] / NS_PER_S);
+            }
+            if (!i) {
+                continue;
+            }
+            double d = (frames[i] - frames[i - 1]) / NS_PER_S;
+            sum += d;
+            sum2 += d * d;
+            lo = i == 1 || d < lo ? d : lo;
+            hi = i == 1 || d > hi ? d : hi;
+        }
+        if (n < 2) {
+            printf("%-3c %9.0f %9zu   (too few frames)\n", digits[setting], nominal[setting], n);
+            continue;
+        }
+        double mean = sum / (n - 1);
+        double jitter = sqrt(fmax(0, sum2 / (n - 1) - mean * mean)) * 1000;
+        double drift = (mean - nominal[setting]) / nominal[setting] * 1e6;
+        // how far the last frame is behind the nominal grid started by the first
+        double lag = (frames[n - 1] - frames[0]) / NS_PER_S - (n - 1) * nominal[setting];
+        printf("%-3c %9.0f %9zu %8zu %10.4f %11.0f %10.3f %10.4f %10.4f %10.1f\n", digits[setting],
+               nominal[setting], n, per_day, mean, drift, jitter, lo, hi, lag);
+    }
+    if (csv) {
+        fclose(csv);
+    }
+    return 0;
+}
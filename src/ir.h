@@ -0,0 +1,66 @@
+#ifndef _IR_H_
+#define _IR_H_
+
+// Canon RC-1 style release: two bursts of NPULSES carrier edges, HPERIOD us
+// apart, separated by SHUT_INSTANT (or SHUT_DELAYED for the 2 s release) us.
+// With its loop overhead the bit-banged burst is meant to land near the
+// CARRIER_HZ of the RC-1, a timer generated carrier runs at CARRIER_HZ
+// itself; tools/irwave measures either against the hand-written reference
+// in tools/irgolden.txt. The timelapse and the manual remote in test/ send
+// the same bursts from here.
+
+#define CARRIER_HZ                          32700
+#define NPULSES                             40
+#define HPERIOD                             10
+#define SHUT_INSTANT                        7330
+#define SHUT_DELAYED                        5360
+
+// the constants build anywhere, the bursts need the board and Timer0
+#ifdef TCCR0A
+
+#ifdef PRR
+#include <avr/power.h>
+#endif
+#include "board.h"
+#include "wait.h"
+
+#ifdef BOARD_IR_TIMER1
+void send_pulses() {
+    // Timer1 toggles OC1A at twice CARRIER_HZ, the burst length is timed by
+    // the CPU; the forced compare makes the first edge immediate
+    power_timer1_enable();
+    OCR1A = F_CPU / (2 * CARRIER_HZ) - 1;
+    TCNT1 = 0;
+    TCCR1A = (1 << COM1A0);                 // toggle OC1A on compare match
+    TCCR1C = (1 << FOC1A);
+    TCCR1B = (1 << WGM12) | (1 << CS10);    // CTC, no prescaling
+    wait_us((NPULSES - 1) * 1000000UL / (2 * CARRIER_HZ));
+    TCCR1B = 0x00;
+    TCCR1A = 0x00;                          // OC1A falls back to LedPin, low
+    power_timer1_disable();
+}
+#else
+void send_pulses() {
+    uint8_t i = 0;
+    for(i = 0; i < NPULSES; i++) {
+        LedPin::toggle();
+        delay_us(HPERIOD);                  // an IDLE wake-up would stretch the edge
+    }
+    LedPin::low();
+}
+#endif
+
+// one release, both bursts; with a constant argument only one wait is built
+static inline __attribute__((always_inline)) void ir_release(bool delayed) {
+    send_pulses();
+    if (delayed) {
+        wait_us(SHUT_DELAYED);
+    } else {
+        wait_us(SHUT_INSTANT);
+    }
+    send_pulses();
+}
+
+#endif //TCCR0A
+
+#endif //_IR_H_
@@ -1,32 +1,59 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
-#ifdef __AVR_ATtiny45__
+#ifdef PRR
 #include <avr/power.h>
 #endif
+#include <avr/pgmspace.h>
 #include <avr/sleep.h>
 
-#ifdef _USE_UTIL_DELAY
-#include <util/delay.h>
-#endif
+#include "board.h"
+#include "delay.h"
+#include "ir.h"
+#include "motion.h"
+#include "powerfail.h"
+#include "preset.h"
+#include "sequence.h"
+#include "session.h"
+#include "stack.h"
+#include "trace.h"
+#include "wait.h"
 
 #ifdef _USE_EEPROM_
 #include <avr/eeprom.h>
 uint8_t EEMEM _saved_data;
 #endif
 
-void send_pulses();
 void shoot_camera();
 void wdt_disable();
 void wdt_enable();
 void shift(uint8_t data);
 
 #define WDT_DEFAULT                         (1 << WDP2)   // 0.25 sec
+#define WDT_PRESCALER(WDT)                  (((WDT) & 0x07) | ((WDT) >> WDP3 & 1) << 3)
+#ifdef _WARM_RESTART_
+#define WDT_RESET                           (1 << WDE)    // interrupt, then reset
+#else
+#define WDT_RESET                           0
+#endif
+#define PEEK_PRESCALER                      7             // 2 sec, at least one program tick
+#define WDT_BITS(P)                         (((P) & 0x07) | ((P) >> 3) << WDP3)
+
+#ifdef _WIRED_RELEASE_
+#ifndef BOARD_WIRED_RELEASE
+#error "_WIRED_RELEASE_ needs FocusPin and ShutterPin in the board descriptor"
+#endif
+#ifndef FOCUS_LEAD
+#define FOCUS_LEAD                          5             // WDT prescaler, 0.5 sec
+#endif
+#define RELEASE_HOLD_US                     100000UL      // shutter line closed
+static_assert(FOCUS_LEAD < 6, "the focus lead must be shorter than the 1 sec program tick");
+#endif //_WIRED_RELEASE_
 
-#define SR595_SER_DATA                      PB0	// 14 pin
-#define SR595_RCLK_LATCH                    PB1	// 12 pin
-#define SR595_SRCLK_CLOCK                   PB2	// 11 pin
-#define BUTTON_PIN                          PB3
-#define LED_PIN                             PB4
+#ifdef _SHOT_BLINK_
+#ifndef SHOT_BLINK_US
+#define SHOT_BLINK_US                       300           // dot lit after every frame
+#endif
+#endif //_SHOT_BLINK_
 
 #define _HA                                 0 // B segment
 #define _HB                                 1 // C segment
@@ -42,21 +69,34 @@ void shift(uint8_t data);
 #else
 #define SETUP_DIGIT(X)                      0xFF & ~(X) // common anode 7segment indicator
 #endif
+#define BLANK                               SETUP_DIGIT(0x00)
+#ifndef BOARD_SHOT_BUTTON
+#define SHOT_HOLD_MS                        800         // a press this long from the dark display shoots
+#define SHOT_POLL_MS                        20
+#endif
 #define MAKE_LOW(X, Y)                      X &= ~(1 << Y)
 #define MAKE_HIGH(X, Y)                     X |= (1 << Y)
 #define TOGGLE_BIT(X, Y)                    X ^= (1 << Y)
 
-#ifdef _USE_EEPROM_
-uint8_t _data;
-#else
-uint8_t _data = 0xFF;
-#endif //_USE_EEPROM_
+uint8_t _data = 0;
 
 uint16_t _app_state = 0;
 uint8_t _flash_cnt = 0;
-uint8_t _flashed = 0;
 uint8_t _display_timeout = 0;
-uint16_t _program_cnt = 0;
+uint8_t _program_cnt = 0;
+volatile uint8_t _wdt_ticks = 0;            // counted by ISR(WDT_vect) only
+uint8_t _wdt_ticks_seen = 0;
+#ifdef _WIRED_RELEASE_
+uint8_t _lead_p = FOCUS_LEAD;               // WDT prescaler of the next slice
+#endif
+#ifdef _PRESET_
+uint8_t _protocol = PRESET_INSTANT;
+uint16_t _frames_left = 0;                  // frame limit of the preset, 0 for none
+uint16_t _start_ticks = 0;                  // start delay of the preset
+#define START_PENDING                       (_start_ticks != 0)
+#else
+#define START_PENDING                       false
+#endif
 
 #define SET_MODE(_MODE)                     MAKE_HIGH(_app_state, _MODE)
 #define IS_MODE(_MODE)                      _app_state & (1 << _MODE)
@@ -73,35 +113,36 @@ uint16_t _program_cnt = 0;
 #define SHOOT_CAMERA                        9
 #define RUN_PROGRAM                         10
 #define SHOOT_SINGLE_CAMERA                 11
+#define PEEK_VALUE                          12
+#define FOCUSED                             13
 
-#define CONVERT_MS_TO_CYCLES(MS)            (MS * ((double)F_CPU / (double)1000000UL))
-
-#define NPULSES                             40
-#define HPERIOD                             CONVERT_MS_TO_CYCLES(10)
-#define SHUT_INSTANT                        CONVERT_MS_TO_CYCLES(7330)
-#define SHUT_DELAYED                        CONVERT_MS_TO_CYCLES(5360)
-
-
+#ifdef _BENCH_
+static void _power_sleep() __attribute__((noinline));   // keep a symbol for tools/bench
+#else
 static inline void _power_sleep() __attribute__((always_inline));
-#ifndef _USE_UTIL_DELAY
-static inline void _delay_loop_2(uint16_t __count) __attribute__((always_inline));
-#define delay_us(cycles) _delay_loop_2(cycles / 2)
 #endif
 
+#ifdef _WIRED_RELEASE_
 void shoot_camera() {
-    send_pulses();
-    delay_us(SHUT_INSTANT);
-    send_pulses();
-}
-
-void send_pulses() {
-    uint8_t i = 0;
-    for(i = 0; i < NPULSES; i++) {
-        PORTB ^= (1 << LED_PIN);
-        delay_us(HPERIOD);
+    // focus is already on for scheduled frames; a single shot during the
+    // focus lead leaves it on for the frame
+    FocusPin::high();
+    ShutterPin::high();
+    wait_us(RELEASE_HOLD_US);
+    ShutterPin::low();
+    if (!(IS_MODE(FOCUSED))) {
+        FocusPin::low();
     }
-    PORTB &= ~(1 << LED_PIN);
 }
+#else
+void shoot_camera() {
+#ifdef _PRESET_
+    ir_release(_protocol == PRESET_DELAYED);
+#else
+    ir_release(false);
+#endif
+}
+#endif
 
 void wdt_disable() {
     cli();
@@ -125,7 +166,7 @@ struct interval_duration {
     uint8_t     wdt;
 };
 
-static interval_duration durations[] = {
+static const interval_duration durations[] PROGMEM = {
     {   // 0
         .digit      = SETUP_DIGIT((1 << _HA) | (1 << _HB) | (1 << _HC) | (1 << _HD) | (1 << _HE) | (1 << _HF)),
         .interval   = 0,
@@ -169,7 +210,7 @@ static interval_duration durations[] = {
     {   // 8
         .digit      = SETUP_DIGIT((1 << _HA) | (1 << _HF) | (1 << _HG) | (1 << _HC) | (1 << _HD) | (1 << _HE) | (1 << _HB)),
         .interval   = 1,
-        .wdt        = (1 << WDP0)
+        .wdt        = (1 << WDP3) | (1 << WDP0)
     },
     {   // 9
         .digit      = SETUP_DIGIT((1 << _HA) | (1 << _HF) | (1 << _HG) | (1 << _HC) | (1 << _HD) | (1 << _HB)),
@@ -184,7 +225,7 @@ static interval_duration durations[] = {
     {   // b 2
         .digit      = SETUP_DIGIT((1 << _HF) | (1 << _HG) | (1 << _HC) | (1 << _HD) | (1 << _HE)),
         .interval   = 15,
-        .wdt        = (1 << WDP0)
+        .wdt        = (1 << WDP3) | (1 << WDP0)
     },
     {   // c 3
         .digit      = SETUP_DIGIT((1 << _HA) | (1 << _HF) | (1 << _HD) | (1 << _HE)),
@@ -194,7 +235,7 @@ static interval_duration durations[] = {
     {   // d 4
         .digit      = SETUP_DIGIT((1 << _HG) | (1 << _HC) | (1 << _HD) | (1 << _HB) | (1 << _HE)),
         .interval   = 30,
-        .wdt        = (1 << WDP0)
+        .wdt        = (1 << WDP3) | (1 << WDP0)
     },
     {   // e 5
         .digit      = SETUP_DIGIT((1 << _HA) | (1 << _HF) | (1 << _HG) | (1 << _HD) | (1 << _HE)),
@@ -204,7 +245,7 @@ static interval_duration durations[] = {
     {   // f 6
         .digit      = SETUP_DIGIT((1 << _HA) | (1 << _HF) | (1 << _HG) | (1 << _HE)),
         .interval   = 45,
-        .wdt        = (1 << WDP0)
+        .wdt        = (1 << WDP3) | (1 << WDP0)
     },
     {   // g 7
         .digit      = SETUP_DIGIT((1 << _HA) | (1 << _HF) | (1 << _HD) | (1 << _HE) | (1 << _HC)),
@@ -214,90 +255,340 @@ static interval_duration durations[] = {
     {   // h 8
         .digit      = SETUP_DIGIT((1 << _HF) | (1 << _HG) | (1 << _HC) | (1 << _HE) | (1 << _HB)),
         .interval   = 60,
-        .wdt        = (1 << WDP0)
+        .wdt        = (1 << WDP3) | (1 << WDP0)
+    },
+#ifdef _SEQUENCE_
+    {   // P, the EEPROM sequence of sequence.h
+        .digit      = SETUP_DIGIT((1 << _HA) | (1 << _HB) | (1 << _HE) | (1 << _HF) | (1 << _HG)),
+        .interval   = 0,
+        .wdt        = 0
     },
+#endif
 };
 
+#define DURATIONS                           (sizeof(durations) / sizeof(struct interval_duration))
+#define DURATION(FIELD)                     pgm_read_byte(&durations[_data].FIELD)
+#ifdef _SEQUENCE_
+#define IS_SEQUENCE                         (_data == DURATIONS - 1)
+#define PROGRAM_WDT                         (IS_SEQUENCE ? WDT_BITS(_seq.p) : DURATION(wdt))
+#else
+#define IS_SEQUENCE                         false
+#define PROGRAM_WDT                         DURATION(wdt)
+#endif
+
+#ifdef BOARD_DIRECT_DISPLAY
+void shift(uint8_t data, uint8_t flash) {
+    // no shift register on this board, the segments take one port write
+    // and two pins; the inputs on SegmentPort keep their pull-ups
+    if (flash) {
+        data = BLANK;
+    }
+    SegmentPort::port() = data | SEGMENT_INPUTS;
+    Segment5Pin::set(data & (1 << _HF));
+    DotPin::set(data & (1 << _HH));
+}
+#else
 void shift(uint8_t data, uint8_t flash) {
     if (flash) {
-        data = 0xFF;
+        data = BLANK;
     }
     for (uint8_t i = 0; i < 8; i++) {
         if (0 == (data & _BV(7 - i))) {
-            MAKE_LOW(PORTB, SR595_SER_DATA);
+            SrDataPin::low();
         } else {
-            MAKE_HIGH(PORTB, SR595_SER_DATA);
+            SrDataPin::high();
         }
-        MAKE_LOW(PORTB, SR595_SRCLK_CLOCK);
-        MAKE_HIGH(PORTB, SR595_SRCLK_CLOCK);
+        SrClockPin::low();
+        SrClockPin::high();
     }
-    MAKE_LOW(PORTB, SR595_RCLK_LATCH);
-    MAKE_HIGH(PORTB, SR595_RCLK_LATCH);
+    SrLatchPin::low();
+    SrLatchPin::high();
+}
+#endif
+
+void stop_program() {
+    CLEAR_MODE(RUN_PROGRAM);
+    if (IS_MODE(PEEK_VALUE)) {
+        // ended under a peek
+        CLEAR_MODE(PEEK_VALUE);
+        shift(BLANK, 0);
+    }
+    wdt_disable();
+}
+
+void start_program() {
+    SET_MODE(RUN_PROGRAM);
+    TRACE(TRACE_PROGRAM);
+#ifdef _SEQUENCE_
+    if (IS_SEQUENCE) {
+        sequence_start();
+        if (!sequence_step()) {
+            stop_program();
+        }
+    }
+#endif
 }
 
+#ifdef _WARM_RESTART_
+static void session_save() {
+    _session.app_state = _app_state & ((1 << RUN_PROGRAM) | (1 << FOCUSED));
+    _session.data = _data;
+    _session.program_cnt = _program_cnt;
+#ifdef _WIRED_RELEASE_
+    _session.lead_p = _lead_p;
+#endif
+#ifdef _PRESET_
+    _session.protocol = _protocol;
+    _session.frames_left = _frames_left;
+    _session.start_ticks = _start_ticks;
+#endif
+#ifdef _SEQUENCE_
+    _session.seq = _seq;
+#endif
+    _session.crc = session_crc(_session);
+}
+
+static bool session_resume() {
+    if (_session.crc != session_crc(_session) || !(_session.app_state & (1 << RUN_PROGRAM))) {
+        return false;
+    }
+    _app_state = _session.app_state;
+    _data = _session.data;
+    _program_cnt = _session.program_cnt;
+#ifdef _WIRED_RELEASE_
+    _lead_p = _session.lead_p;
+    if (IS_MODE(FOCUSED)) {
+        FocusPin::high();
+    }
+#endif
+#ifdef _PRESET_
+    _protocol = _session.protocol;
+    _frames_left = _session.frames_left;
+    _start_ticks = _session.start_ticks;
+#endif
+#ifdef _SEQUENCE_
+    _seq = _session.seq;
+#endif
+    _wdt_ticks = SESSION_LOST_TICKS;
+    return true;
+}
+#endif //_WARM_RESTART_
+
 ISR(PCINT0_vect) {
     cli();
-    if (!(PINB & (1 << BUTTON_PIN))) {
+    if (ButtonPin::is_low()) {
         SET_MODE(BUTTON_MODE);
     }
     sei();
 }
 
-ISR(WDT_vect) {}
+#ifdef BOARD_SHOT_BUTTON
+ISR(SHOT_BUTTON_vect) {
+    if (ShotButtonPin::is_low()) {
+        SET_MODE(SHOOT_SINGLE_CAMERA);
+    }
+}
+#else
+// no shot button: a press held for SHOT_HOLD_MS while the display is dark,
+// idle or running a program, is a single shot; a shorter one wakes the
+// display or peeks as before. The polls sleep in IDLE where wait.h has it
+static bool shot_hold() {
+    for (uint16_t held = 0; held < SHOT_HOLD_MS; held += SHOT_POLL_MS) {
+        if (ButtonPin::is_high()) {
+            return false;
+        }
+        wait_us(SHOT_POLL_MS * 1000UL);
+    }
+    return true;
+}
+#endif
+
+ISR(WDT_vect) {
+    _wdt_ticks++;
+}
+
+static inline void cold_boot() {
+#ifdef _USE_EEPROM_
+    _data = eeprom_read_byte(&_saved_data);
+    if (_data >= DURATIONS) { _data = 0x00; }
+#endif //_USE_EEPROM_
+
+#ifdef _PRESET_
+    preset p;
+    if (preset_load(p) && p.setting && p.setting < DURATIONS) {
+        // straight into the program, the display stays dark
+        _data = p.setting;
+        _protocol = p.protocol;
+        _frames_left = p.frames;
+        if (!IS_SEQUENCE) {
+            uint8_t tick_s = WDT_PRESCALER(DURATION(wdt)) - 6;  // 1 sec << tick_s
+            _start_ticks = (p.start_s + (1 << tick_s) - 1) >> tick_s;
+        }
+        start_program();
+    } else
+#endif
+    SET_MODE(DISPLAY_VALUE);
+}
 
 int main() {
+#ifdef _WARM_RESTART_
+    uint8_t reset_flags = MCUSR;            // wdt_enable() clears WDRF
+#endif
     wdt_enable(WDT_DEFAULT);
-    DDRB = 0xFF & ~(1 << BUTTON_PIN);
-    PORTB = 0x00 | (1 << BUTTON_PIN);
+    BOARD_SYMBOLS();
+    ButtonPin::port_t::ddr() = 0xFF & ~ButtonPin::mask;
+    ButtonPin::port_t::port() = 0x00 | ButtonPin::mask;
+#ifdef BOARD_DIRECT_DISPLAY
+    SegmentPort::ddr() = 0xFF & ~SEGMENT_INPUTS;
+    Segment5Pin::output();
+    DotPin::output();
+    shift(BLANK, 0);
+#endif
+#ifdef _WIRED_RELEASE_
+    FocusPin::low();                        // not on ButtonPin's port on every board
+    FocusPin::output();
+    ShutterPin::low();
+    ShutterPin::output();
+#endif
+#ifdef _MOTION_
+    motion_init();
+#endif
+#ifdef _POWER_FAIL_
+    power_fail_init();
+#endif
+#ifdef ADCSRA
     MAKE_LOW(ADCSRA, ADEN);                 // turn off ADC
-    MAKE_LOW(ACSR, ACD);                    // turn off Analog Comparator
-#ifdef __AVR_ATtiny45__
+#endif
+    MAKE_HIGH(ACSR, ACD);                   // turn off Analog Comparator
+#ifdef PRADC
     power_adc_disable();
+#endif
+#ifdef PRTIM0
     power_timer0_disable();
+#endif
+#ifdef PRTIM1
     power_timer1_disable();
+#endif
+#ifdef PRUSI
     power_usi_disable();
 #endif
-    MAKE_HIGH(PCMSK, PCINT3);               // enable PCINT3
+#ifdef PRUSART
+    power_usart_disable();
+#endif
+    MAKE_HIGH(PCMSK, ButtonPin::bit);       // enable PCINT on the button pin
+#ifdef BOARD_SHOT_BUTTON
+    MAKE_HIGH(SHOT_BUTTON_PCMSK, ShotButtonPin::bit);
+#endif
     sei();
     MAKE_HIGH(GIMSK, PCIE);                 // enable global pc interrupts
+#ifdef BOARD_SHOT_BUTTON
+    MAKE_HIGH(GIMSK, SHOT_BUTTON_PCIE);
+#endif
+#ifdef _POWER_FAIL_
+    power_fail_arm();
+#endif
 
-#ifdef _USE_EEPROM_
-    _data = eeprom_read_byte(&_saved_data);
-    if (_data == 0xFF) { _data = 0x00; }
-#endif //_USE_EEPROM_
-
-    SET_MODE(DISPLAY_VALUE);
+    TRACE(TRACE_BOOT);
+#ifdef _WARM_RESTART_
+    if ((reset_flags & (1 << WDRF)) && session_resume()) {
+        // a hang ran into the watchdog, on with the program it broke off
+        TRACE(TRACE_RESUME);
+#ifndef BOARD_DIRECT_DISPLAY
+        shift(BLANK, 0);                    // the 74HC595 kept its outputs
+#endif
+    } else
+#endif
+    cold_boot();
 
     while (true) {
+        if (IS_MODE(SHOOT_SINGLE_CAMERA)) {
+            // first thing after the wake-up, before the display; a program
+            // keeps its count. Cleared after the shot, so contact bounce
+            // during the release does not fire again
+            shoot_camera();
+            TRACE(TRACE_SHOT);
+            CLEAR_MODE(SHOOT_SINGLE_CAMERA);
+        }
         if (IS_MODE(BUTTON_MODE)) {
-            if (++_data >= (sizeof(durations) / sizeof(struct interval_duration))) {
-                _data = 0;
+            TRACE(TRACE_BUTTON);
+#if defined(_WARM_RESTART_) && (defined(_TRACE_) || !defined(BOARD_SHOT_BUTTON))
+            if (WDTCR & (1 << WDE)) {
+                // the holds and the dump outlast a tick, the interrupt alone
+                wdt_enable(WDTCR & ((1 << WDP3) | 0x07));
+            }
+#endif
+#ifndef BOARD_SHOT_BUTTON
+            if (!(IS_MODE(FLASH_VALUE) || IS_MODE(COUNT_TO_DISPLAY_OFF) || IS_MODE(PEEK_VALUE)) && shot_hold()) {
+                // the release to come only wakes, the button reads high
+                CLEAR_MODE(BUTTON_MODE);
+                SET_MODE(SHOOT_SINGLE_CAMERA);
+                continue;
+            }
+#endif
+#ifdef _TRACE_
+            if (trace_long_press()) {
+                CLEAR_MODE(BUTTON_MODE);
+                trace_dump();
+                continue;
+            }
+#endif //_TRACE_
+            if (IS_MODE(RUN_PROGRAM) && !(IS_MODE(PEEK_VALUE))) {
+                // the first press while running only shows the setting, dot
+                // lit, and leaves the program alone; see cycles.md
+                SET_MODE(PEEK_VALUE);
+                CLEAR_MODE(BUTTON_MODE);
+                _display_timeout = 0;
+                shift(DURATION(digit) ^ (1 << _HH), 0);
+            } else {
+                if (++_data >= DURATIONS) {
+                    _data = 0;
+                }
+                _flash_cnt = 0;
+                SET_MODE(TURN_ON_SR_LED);
+                CLEAR_MODE(BUTTON_MODE);
+                // a turn-off or flash end still pending from the last
+                // setting would start the program with the display on
+                CLEAR_MODE(TURN_OFF_SR_LED);
+                CLEAR_MODE(TURN_OFF_FLASH);
+                CLEAR_MODE(FLASHED_VALUE);
+                CLEAR_MODE(COUNT_TO_DISPLAY_OFF);
+                CLEAR_MODE(RUN_PROGRAM);
+                CLEAR_MODE(PEEK_VALUE);
+                _program_cnt = 0;
+#ifdef _WIRED_RELEASE_
+                FocusPin::low();
+                CLEAR_MODE(FOCUSED);
+                _lead_p = FOCUS_LEAD;
+#endif
+#ifdef _PRESET_
+                _frames_left = 0;
+                _start_ticks = 0;
+#endif
             }
-            _flash_cnt = 0;
-            SET_MODE(TURN_ON_SR_LED);
-            CLEAR_MODE(BUTTON_MODE);
-            CLEAR_MODE(COUNT_TO_DISPLAY_OFF);
-            CLEAR_MODE(RUN_PROGRAM);
-            _program_cnt = 0;
         }
         if (IS_MODE(TURN_ON_SR_LED)) {
             // turn on Shift Register and LED
             SET_MODE(DISPLAY_VALUE);
             CLEAR_MODE(TURN_ON_SR_LED);
             wdt_enable(WDT_DEFAULT);
+            TRACE(TRACE_DISPLAY_ON);
         }
         if (IS_MODE(TURN_OFF_SR_LED)) {
             // turn off Shift Register and LED
-            shift(0xFF, 0);
+            shift(BLANK, 0);
             CLEAR_MODE(TURN_OFF_SR_LED);
+            TRACE(TRACE_DISPLAY_OFF);
             if (_data) {
-                SET_MODE(RUN_PROGRAM);
+                start_program();
             } else {
                 wdt_disable();
+#ifdef _POWER_FAIL_
+                power_fail_checkpoint();    // no wake-up samples the supply from here
+#endif
             }
-#ifdef _USE_EEPROM_
+#if defined(_USE_EEPROM_) && !defined(_POWER_FAIL_)
             eeprom_write_byte(&_saved_data, _data);
-#endif //_USE_EEPROM_
+#endif
         }
         if (IS_MODE(COUNT_TO_DISPLAY_OFF)) {
             _display_timeout++;
@@ -309,7 +600,7 @@ int main() {
             }
         }
         if (IS_MODE(DISPLAY_VALUE)) {
-            shift(durations[_data].digit, IS_MODE(FLASHED_VALUE));
+            shift(DURATION(digit), IS_MODE(FLASHED_VALUE));
             CLEAR_MODE(DISPLAY_VALUE);
             if (IS_MODE(TURN_OFF_FLASH)) {
                 CLEAR_MODE(TURN_OFF_FLASH);
@@ -332,46 +623,131 @@ int main() {
         }
         if (IS_MODE(SHOOT_CAMERA)) {
             shoot_camera();
+            TRACE(TRACE_SHOT);
             CLEAR_MODE(SHOOT_CAMERA);
+#ifdef _SHOT_BLINK_
+            if (!(IS_MODE(PEEK_VALUE))) {
+                // the display is dark while a program runs, unless peeking
+                // with the dot already lit
+                shift(SETUP_DIGIT(1 << _HH), 0);
+                wait_us(SHOT_BLINK_US);
+                shift(BLANK, 0);
+            }
+#endif
             _program_cnt = 0;
-        }
-        if (IS_MODE(SHOOT_SINGLE_CAMERA)) {
-            shoot_camera();
-            CLEAR_MODE(SHOOT_SINGLE_CAMERA);
+#ifdef _PRESET_
+            if (_frames_left && !--_frames_left) {
+                stop_program();
+            }
+#endif
+#ifdef _MOTION_
+            if (IS_MODE(RUN_PROGRAM)) {
+                motion_move();              // not after the last frame of a preset
+            }
+#endif
         }
         _power_sleep();
-        if (IS_MODE(RUN_PROGRAM)) {
-            _program_cnt++;
-            if (_program_cnt >= durations[_data].interval) {
-                _program_cnt = 0;
-                SET_MODE(SHOOT_CAMERA);
+        TRACE_WAKE(IS_MODE(RUN_PROGRAM) ? TRACE_RUNNING :
+                   IS_MODE(COUNT_TO_DISPLAY_OFF) || IS_MODE(FLASH_VALUE) ? TRACE_DISPLAY : TRACE_IDLE);
+        // only WDT wake-ups are program ticks, button wake-ups are not
+        while (_wdt_ticks_seen != _wdt_ticks) {
+            _wdt_ticks_seen++;
+            if (IS_MODE(PEEK_VALUE)) {
+                // the peek keeps the WDT period armed for the program, a
+                // lead slice of _WIRED_RELEASE_ too, and ends on a tick;
+                // counted in 16 ms WDT cycles
+                uint8_t p = WDT_PRESCALER(WDTCR);
+                if (p >= PEEK_PRESCALER || (_display_timeout += 1 << p) >= 1 << PEEK_PRESCALER) {
+                    _display_timeout = 0;
+                    shift(BLANK, 0);
+                    CLEAR_MODE(PEEK_VALUE);
+                }
+            }
+            if (IS_MODE(RUN_PROGRAM)) {
+#ifdef _SEQUENCE_
+                if (IS_SEQUENCE) {
+                    if (!sequence_tick()) {
+                        stop_program();
+                    }
+                    continue;
+                }
+#endif
+#ifdef _PRESET_
+                if (_start_ticks) {
+                    _start_ticks--;
+                    continue;
+                }
+#endif
+#ifdef _WIRED_RELEASE_
+                // the tick before a frame is slept in slices of FOCUS_LEAD,
+                // FOCUS_LEAD + 1 .. program - 1, then FOCUS_LEAD again with
+                // focus on: they add up to one program tick
+                if (_program_cnt + 1 >= DURATION(interval) && !(IS_MODE(FOCUSED))) {
+                    if (_lead_p + 1 < WDT_PRESCALER(DURATION(wdt))) {
+                        _lead_p++;
+                    } else {
+                        _lead_p = FOCUS_LEAD;
+                        FocusPin::high();
+                        SET_MODE(FOCUSED);
+                    }
+                    continue;
+                }
+#endif
+                _program_cnt++;
+                if (_program_cnt >= DURATION(interval)) {
+                    _program_cnt = 0;
+                    SET_MODE(SHOOT_CAMERA);
+#ifdef _WIRED_RELEASE_
+                    CLEAR_MODE(FOCUSED);
+#endif
+                    break;                  // the shot first, the ticks left count from it
+                }
             }
         }
     }
     return 0;
 }
 
-#ifndef _USE_UTIL_DELAY
-void _delay_loop_2(uint16_t __count) {
-    __asm__ volatile (
-        "1: sbiw %0,1" "\n\t"
-        "brne 1b"
-            : "=w" (__count)
-            : "0" (__count)
-    );
-}
-#endif
-
 void _power_sleep() {
+#ifdef _WIRED_RELEASE_
+    if (IS_MODE(RUN_PROGRAM) && !IS_SEQUENCE && !START_PENDING && _program_cnt + 1 >= DURATION(interval)) {
+        wdt_enable(WDT_BITS(_lead_p) | WDT_RESET);
+    } else
+#endif
     if (IS_MODE(RUN_PROGRAM)) {
-        wdt_enable(durations[_data].wdt);
+        wdt_enable(PROGRAM_WDT | WDT_RESET);
     }
+#ifdef _POWER_FAIL_
+    power_fail_service();
+#endif
     set_sleep_mode(SLEEP_MODE_PWR_DOWN);
     cli();
+#ifdef _WARM_RESTART_
+    if (IS_MODE(RUN_PROGRAM)) {
+        session_save();
+    }
+#endif
+    if (_wdt_ticks_seen != _wdt_ticks) {
+        // a tick came in while awake, it is counted before sleeping
+        sei();
+        return;
+    }
+#ifdef _POWER_FAIL_
+    if (_power_failing || power_fail_pending()) {
+        // the supply fell since power_fail_service(), the next pass writes
+        sei();
+        return;
+    }
+    power_fail_disarm();
+#endif
     sleep_enable();
+#ifdef sleep_bod_disable
     sleep_bod_disable();
+#endif
     sei();
     sleep_cpu();
     sleep_disable();
-    wdt_enable(WDT_DEFAULT);
+#ifdef _POWER_FAIL_
+    power_fail_arm();
+#endif
 }
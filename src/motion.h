@@ -0,0 +1,79 @@
+#ifndef _MOTION_H_
+#define _MOTION_H_
+
+// Shoot-move-shoot for a slider stepper, built in with -D_MOTION_ on a board
+// with StepPin on OC0A and DirPin. After every frame of a program Timer0
+// toggles StepPin at twice MOTION_STEP_HZ, MOTION_STEPS pulses, the CPU in
+// IDLE meanwhile. The WDT keeps counting program ticks through the move, so
+// the frames stay on their grid. The frames of an EEPROM sequence do not
+// move.
+//
+// There is no settle wait: the move starts right after a release and the
+// next one is at least a 1 sec tick away, so the slider settles for whatever
+// is left of that tick, 900 ms less MOTION_MS with the WDT 10 % fast. The
+// static_assert below only keeps the move inside that tick; a rig that
+// needs a longer settle needs fewer or faster steps.
+//
+// On the ATtiny2313A DirPin is on the ISP's MOSI and only sets the
+// direction. StepPin is not an ISP line, but it floats with every other pin
+// while RESET is held; the driver's STEP input needs a pull-down so the
+// slider does not creep during programming.
+
+#ifdef _MOTION_
+
+#include "board.h"
+#include "wait.h"
+
+#ifndef BOARD_MOTION
+#error "_MOTION_ needs StepPin and DirPin in the board descriptor"
+#endif
+#if !WAIT_IDLE
+#error "_MOTION_ steps from wait_idle(), build with WAIT_IDLE"
+#endif
+
+#ifndef MOTION_STEPS
+#define MOTION_STEPS                        32          // per frame
+#endif
+#ifndef MOTION_STEP_HZ
+#define MOTION_STEP_HZ                      200
+#endif
+#ifndef MOTION_DIR
+#define MOTION_DIR                          1           // DirPin level
+#endif
+#define MOTION_MS                           (MOTION_STEPS * 1000UL / MOTION_STEP_HZ)
+
+namespace motion {
+
+// the smallest Timer0 prescaler that reaches half a step period
+constexpr uint8_t cs(uint8_t c = 1) {
+    return c == 5 || F_CPU / (2UL * MOTION_STEP_HZ) / wait::prescale(c) <= 256 ? c : cs(c + 1);
+}
+
+constexpr uint16_t count() {
+    return F_CPU / (2UL * MOTION_STEP_HZ) / wait::prescale(cs());
+}
+
+} // namespace motion
+
+static_assert(motion::count() >= 2 && motion::count() <= 256, "MOTION_STEP_HZ out of Timer0 range at F_CPU");
+static_assert(MOTION_MS < 900, "the move must end within the 1 sec interval, -10 %");
+
+static inline void motion_init() {
+    DirPin::set(MOTION_DIR);
+    DirPin::output();
+    StepPin::low();
+    StepPin::output();
+}
+
+static void motion_move() {
+    // two compares a step, in runs of up to WAIT_IDLE_MAX_TURNS
+    for (uint16_t toggles = 2 * MOTION_STEPS; toggles; ) {
+        uint8_t turns = toggles > WAIT_IDLE_MAX_TURNS - 1 ? WAIT_IDLE_MAX_TURNS - 1 : toggles;
+        wait_idle(motion::cs(), turns, motion::count() - 1, 1 << COM0A0);
+        toggles -= turns;
+    }
+}
+
+#endif //_MOTION_
+
+#endif //_MOTION_H_
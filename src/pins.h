@@ -0,0 +1,48 @@
+#ifndef _PINS_H_
+#define _PINS_H_
+
+#include <avr/io.h>
+
+// Compile-time pin access. Every member is always_inline on a constant I/O
+// address and bit, so with -Os high()/low() end up as a single sbi/cbi and
+// is_high()/is_low() in a condition as a single sbis/sbic; tools/pincheck.sh
+// checks that in the disassembly.
+
+#define PINS_INLINE                         static inline __attribute__((always_inline))
+
+#define DECLARE_PORT(NAME, X)                                                   \
+    struct NAME {                                                               \
+        static constexpr char letter = #X[0];                                   \
+        PINS_INLINE auto& port() { return PORT##X; }                            \
+        PINS_INLINE auto& ddr() { return DDR##X; }                              \
+        PINS_INLINE auto& pin() { return PIN##X; }                              \
+    }
+
+#ifdef PORTA
+DECLARE_PORT(PortA, A);
+#endif
+#ifdef PORTB
+DECLARE_PORT(PortB, B);
+#endif
+#ifdef PORTD
+DECLARE_PORT(PortD, D);
+#endif
+
+template <class Port, uint8_t Bit>
+struct Pin {
+    typedef Port port_t;
+    static constexpr uint8_t bit = Bit;
+    static constexpr uint8_t mask = 1 << Bit;
+
+    PINS_INLINE void high() { Port::port() |= mask; }
+    PINS_INLINE void low() { Port::port() &= ~mask; }
+    PINS_INLINE void set(bool value) { if (value) { high(); } else { low(); } }
+    // writing a one to PINx flips PORTx on every supported AVR
+    PINS_INLINE void toggle() { Port::pin() = mask; }
+    PINS_INLINE void output() { Port::ddr() |= mask; }
+    PINS_INLINE void input() { Port::ddr() &= ~mask; }
+    PINS_INLINE bool is_high() { return Port::pin() & mask; }
+    PINS_INLINE bool is_low() { return !(Port::pin() & mask); }
+};
+
+#endif //_PINS_H_
@@ -0,0 +1,96 @@
+#ifndef _POWERFAIL_H_
+#define _POWERFAIL_H_
+
+// Power-fail checkpoint, built in with -D_POWER_FAIL_ -D_USE_EEPROM_ on a
+// board with SupplyTapPin. The analog comparator sets ACO when the divided
+// supply on AIN1 falls below the bandgap; its interrupt only flags it, and
+// the main loop writes _data to the EEPROM before it sleeps again. The main
+// loop is the only EEPROM writer, so no write can break into another, and a
+// running timelapse wears no EEPROM cell until the battery goes.
+//
+// The comparator and the bandgap only run while the CPU is awake, they do
+// not wake it from power-down, so the supply is sampled once per wake-up,
+// as often as the WDT period, up to 8 sec apart. The bulk capacitor carries
+// the MCU from POWER_FAIL_MV down to the EEPROM write minimum over that
+// time, and the write itself:
+//
+//    C >= (I_sleep * 8 s + I_write * t_write) / (POWER_FAIL_MV - V_min)
+//
+// about 100 uF for 5 uA asleep, 3 mA for 3.4 ms and 2.7 V down to 1.8 V.
+// With the WDT off, the display dark and no program, nothing is sampled:
+// _data is written once before that sleep instead, if it changed.
+//
+// The divider puts AIN1 at the bandgap, 1.1 V, at POWER_FAIL_MV, e.g.
+// 1.5 M over 1 M for 2.7 V, its own draw below a microampere at 3 V.
+
+#ifdef _POWER_FAIL_
+
+#include <avr/eeprom.h>
+#include "board.h"
+#include "wait.h"
+
+#ifndef BOARD_POWER_FAIL
+#error "_POWER_FAIL_ needs SupplyTapPin in the board descriptor"
+#endif
+#ifndef _USE_EEPROM_
+#error "_POWER_FAIL_ checkpoints the _USE_EEPROM_ setting"
+#endif
+
+#define POWER_FAIL_MV                       2700        // see the divider above
+#define POWER_FAIL_SETTLE_US                70          // bandgap start-up, max
+
+extern uint8_t _data;
+extern uint8_t _saved_data;
+
+volatile uint8_t _power_failing = 0;
+
+static inline void power_fail_checkpoint() {
+    eeprom_update_byte(&_saved_data, _data);
+}
+
+ISR(ANA_COMP_vect) {
+    ACSR &= ~(1 << ACIE);                   // once per wake-up
+    _power_failing = 1;
+}
+
+// from the main loop only, before every sleep
+static inline void power_fail_service() {
+    if (_power_failing) {
+        _power_failing = 0;
+        power_fail_checkpoint();
+    }
+}
+
+static inline void power_fail_init() {
+    SupplyTapPin::input();
+    SupplyTapPin::low();                    // no pull-up on the divider
+#ifdef AIN1D
+    DIDR = (1 << AIN1D);
+#endif
+}
+
+// on every wake-up: bandgap against AIN1, interrupt as ACO rises
+static inline void power_fail_arm() {
+    ACSR = (1 << ACBG) | (1 << ACIS1) | (1 << ACIS0);
+    wait_us(POWER_FAIL_SETTLE_US);
+    ACSR |= (1 << ACI);                     // edges of the start-up
+    ACSR |= (1 << ACIE);
+    if (ACSR & (1 << ACO)) {
+        ACSR &= ~(1 << ACIE);
+        _power_failing = 1;
+    }
+}
+
+// the comparator interrupt is due but held off by cli()
+static inline bool power_fail_pending() {
+    return (ACSR & ((1 << ACIE) | (1 << ACI))) == ((1 << ACIE) | (1 << ACI));
+}
+
+// before power-down, where it would only draw
+static inline void power_fail_disarm() {
+    ACSR = (1 << ACD);
+}
+
+#endif //_POWER_FAIL_
+
+#endif //_POWERFAIL_H_
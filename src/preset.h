@@ -0,0 +1,49 @@
+#ifndef _PRESET_H_
+#define _PRESET_H_
+
+// Boot preset, built in with -D_PRESET_. A valid preset in EEPROM, written
+// by tools/preset, makes the firmware skip the display at power-on and run
+// its setting straight away: after start_s seconds (rounded up to program
+// ticks) the first interval begins, and the program stops by itself after
+// frames frames. A button press falls back to the usual setup, without the
+// start delay and frame limit. The layout is versioned; an erased, foreign
+// or corrupt preset fails the check and the firmware boots as without one.
+
+#include <stdint.h>
+
+#define PRESET_VERSION                      1
+#define PRESET_INSTANT                      0           // SHUT_INSTANT release
+#define PRESET_DELAYED                      1           // SHUT_DELAYED, the 2 sec self-timer
+
+struct __attribute__((packed)) preset {
+    uint8_t     version;                    // PRESET_VERSION
+    uint8_t     setting;                    // durations[] index, not 0
+    uint8_t     protocol;
+    uint16_t    frames;                     // 0 for no limit, not for the sequence
+    uint16_t    start_s;                    // not for the sequence setting
+    uint8_t     check;                      // preset_check() of the bytes above
+};
+
+static inline uint8_t preset_check(const preset& p) {
+    const uint8_t* bytes = (const uint8_t*)&p;
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < sizeof(preset) - 1; i++) {
+        sum += bytes[i];
+    }
+    return ~sum;
+}
+
+#ifdef _PRESET_
+
+#include <avr/eeprom.h>
+
+preset EEMEM _preset;
+
+static bool preset_load(preset& p) {
+    eeprom_read_block(&p, &_preset, sizeof(p));
+    return p.version == PRESET_VERSION && p.check == preset_check(p);
+}
+
+#endif //_PRESET_
+
+#endif //_PRESET_H_
@@ -0,0 +1,157 @@
+#ifndef _SEQUENCE_H_
+#define _SEQUENCE_H_
+
+// Shooting sequences, built in with -D_SEQUENCE_. A bytecode program in
+// EEPROM runs as the extra setting 'P' after the durations[] table. It is
+// stepped on every program tick: a wait only counts its WDT periods down,
+// anything else runs until the next wait, at most SEQUENCE_STEPS
+// instructions per tick, so the CPU sleeps through every wait. Written with
+// tools/seqasm, which also documents the source syntax.
+//
+//    0x0p n                    - wait n periods of WDT prescaler p (4..9)
+//    0x10                      - shoot
+//    0x2p n                    - bulb: shoot, wait n periods of p, shoot
+//    0x3r n                    - set counter r (0..3) to n
+//    0x4r a                    - decrement counter r, go to a unless zero
+//    0x50 a                    - go to a
+//    0x60 lo hi a              - go to a while fewer than hi:lo frames
+//    0xFF                      - end, also erased cells and running off
+//                                the end
+//
+// An unknown opcode, or a wait or bulb with p outside 4..9, ends the
+// sequence like an end.
+
+#define SEQ_WAIT                            0x00
+#define SEQ_SHOOT                           0x10
+#define SEQ_BULB                            0x20
+#define SEQ_SET                             0x30
+#define SEQ_LOOP                            0x40
+#define SEQ_JUMP                            0x50
+#define SEQ_UNTIL                           0x60
+#define SEQ_END                             0xFF
+#define SEQ_COUNTERS                        4
+#define SEQ_MIN_PRESCALER                   4           // 0.25 sec, the display tick
+#define SEQ_MAX_PRESCALER                   9           // 8 sec, the longest WDT period
+#ifndef SEQUENCE_SIZE
+#define SEQUENCE_SIZE                       ((E2END + 1) / 2)
+#endif
+
+#ifdef _SEQUENCE_
+
+#include <avr/eeprom.h>
+#include "board.h"
+#include "trace.h"
+
+#define SEQUENCE_STEPS                      8
+
+void shoot_camera();
+
+struct sequence_state {
+    uint8_t     pc;
+    uint8_t     p;                          // WDT prescaler of the current wait
+    uint8_t     wait;                       // periods left
+    uint8_t     bulb;                       // open exposure, closed after the wait
+    uint8_t     counter[SEQ_COUNTERS];
+    uint16_t    frames;
+};
+
+uint8_t EEMEM _sequence[SEQUENCE_SIZE];
+sequence_state _seq;
+
+static uint8_t sequence_fetch() {
+    return _seq.pc < SEQUENCE_SIZE ? eeprom_read_byte(&_sequence[_seq.pc++]) : SEQ_END;
+}
+
+static void sequence_release(bool open) {
+#ifdef _WIRED_RELEASE_
+    // the shutter line is held for the exposure
+    FocusPin::set(open);
+    ShutterPin::set(open);
+#else
+    // in bulb mode every release toggles the shutter
+    (void)open;
+    shoot_camera();
+#endif
+}
+
+void sequence_start() {
+    _seq = sequence_state();
+    _seq.p = SEQ_MIN_PRESCALER;
+}
+
+// runs up to the next wait, false once the sequence ended
+bool sequence_step() {
+    for (uint8_t steps = SEQUENCE_STEPS; steps; steps--) {
+        uint8_t op = sequence_fetch();
+        uint8_t arg = op & 0x0F;
+        if (((op & 0xF0) == SEQ_WAIT || (op & 0xF0) == SEQ_BULB) &&
+            (arg < SEQ_MIN_PRESCALER || arg > SEQ_MAX_PRESCALER)) {
+            return false;                   // a period the WDT does not have
+        }
+        switch (op & 0xF0) {
+        case SEQ_BULB:
+            sequence_release(true);
+            _seq.bulb = 1;
+            _seq.frames++;
+            TRACE(TRACE_SHOT);
+            // fall through
+        case SEQ_WAIT:
+            _seq.p = arg;
+            if ((_seq.wait = sequence_fetch())) {
+                return true;
+            }
+            if (_seq.bulb) {
+                sequence_release(false);
+                _seq.bulb = 0;
+            }
+            break;
+        case SEQ_SHOOT:
+            shoot_camera();
+            _seq.frames++;
+            TRACE(TRACE_SHOT);
+            break;
+        case SEQ_SET:
+            _seq.counter[arg % SEQ_COUNTERS] = sequence_fetch();
+            break;
+        case SEQ_LOOP: {
+            uint8_t to = sequence_fetch();
+            if (--_seq.counter[arg % SEQ_COUNTERS]) {
+                _seq.pc = to;
+            }
+            break;
+        }
+        case SEQ_JUMP:
+            _seq.pc = sequence_fetch();
+            break;
+        case SEQ_UNTIL: {
+            uint16_t frames = sequence_fetch();
+            frames |= sequence_fetch() << 8;
+            uint8_t to = sequence_fetch();
+            if (_seq.frames < frames) {
+                _seq.pc = to;
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    _seq.wait = 1;                          // out of steps, go on next period
+    return true;
+}
+
+// one program tick, false once the sequence ended
+bool sequence_tick() {
+    if (_seq.wait && --_seq.wait) {
+        return true;
+    }
+    if (_seq.bulb) {
+        sequence_release(false);
+        _seq.bulb = 0;
+    }
+    return sequence_step();
+}
+
+#endif //_SEQUENCE_
+
+#endif //_SEQUENCE_H_
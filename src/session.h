@@ -0,0 +1,63 @@
+#ifndef _SESSION_H_
+#define _SESSION_H_
+
+// Warm restart, built in with -D_WARM_RESTART_. While a program runs the WDT
+// is in its interrupt and reset mode: serving the timeout interrupt clears
+// WDIE, and only _power_sleep() sets it again, so a firmware that hangs is
+// reset by the timeout after the next one. The program state is saved into
+// .noinit, which the C start-up leaves alone, with a CRC-8 each time the
+// firmware goes to sleep. After a watchdog reset main() picks the program up
+// from there, the two timeouts of the hang counted as program ticks, before
+// its first sleep and without the EEPROM or the display.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WARM_RESTART_
+
+#include "sequence.h"
+
+#define SESSION_LOST_TICKS                  2           // unserved interrupt, reset
+#define SESSION_CRC_POLY                    0x07        // CRC-8/ATM
+
+#ifdef __AVR__
+#define NOINIT                              __attribute__((section(".noinit")))
+#else
+#define NOINIT                              __attribute__((section("noinit")))  // see host/mcu.cpp
+#endif
+
+struct session {
+    uint16_t        app_state;              // RUN_PROGRAM and FOCUSED only
+    uint8_t         data;
+    uint8_t         program_cnt;
+#ifdef _WIRED_RELEASE_
+    uint8_t         lead_p;
+#endif
+#ifdef _PRESET_
+    uint8_t         protocol;
+    uint16_t        frames_left;
+    uint16_t        start_ticks;
+#endif
+#ifdef _SEQUENCE_
+    sequence_state  seq;
+#endif
+    uint8_t         crc;                    // session_crc() of the bytes above
+};
+
+session _session NOINIT;
+
+static uint8_t session_crc(const session& s) {
+    const uint8_t* bytes = (const uint8_t*)&s;
+    uint8_t crc = 0xFF;                     // a zeroed block does not pass
+    for (uint8_t i = 0; i < offsetof(session, crc); i++) {
+        crc ^= bytes[i];
+        for (uint8_t bit = 8; bit; bit--) {
+            crc = crc & 0x80 ? (crc << 1) ^ SESSION_CRC_POLY : crc << 1;
+        }
+    }
+    return crc;
+}
+
+#endif //_WARM_RESTART_
+
+#endif //_SESSION_H_
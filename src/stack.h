@@ -0,0 +1,45 @@
+#ifndef _STACK_H_
+#define _STACK_H_
+
+// Stack high-water mark, built in with -D_STACK_CHECK_. Before the C runtime
+// starts, the SRAM between the end of .bss/.noinit and the top of the stack
+// is painted with STACK_CANARY; stack_unused() counts the bytes above _end
+// that were never overwritten since, i.e. the headroom left at the deepest
+// point so far. The _TRACE_ dump reports it. tools/stackreport.sh gives the
+// build-time worst case to compare it with.
+
+#if defined(_STACK_CHECK_) && defined(__AVR__)
+
+#define STACK_CANARY                        0xC5
+
+extern uint8_t _end;                        // linker: end of .bss and .noinit
+extern uint8_t __stack;                     // linker: RAMEND
+
+void stack_paint() __attribute__((naked, used, section(".init1")));
+void stack_paint() {
+    // r1 is not cleared yet this early, so no C here
+    __asm__ volatile(
+        "    ldi r30, lo8(_end)\n"
+        "    ldi r31, hi8(_end)\n"
+        "    ldi r24, %0\n"
+        "    ldi r25, hi8(__stack)\n"
+        "    rjmp 2f\n"
+        "1:  st Z+, r24\n"
+        "2:  cpi r30, lo8(__stack)\n"
+        "    cpc r31, r25\n"
+        "    brlo 1b\n"
+        "    breq 1b\n"
+        :: "M"(STACK_CANARY));
+}
+
+uint16_t stack_unused() {
+    const uint8_t* p = &_end;
+    while (p <= &__stack && *p == STACK_CANARY) {
+        p++;
+    }
+    return p - &_end;
+}
+
+#endif //_STACK_CHECK_
+
+#endif //_STACK_H_
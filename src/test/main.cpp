@@ -1,73 +1,63 @@
+// Manual IR remote: one release per press of ButtonPin, in power-down
+// between presses. Same wiring and IR bursts as the timelapse firmware, see
+// ../board.h and ../ir.h; the WDT, the ADC, the comparator and the timers
+// are off while asleep, so it draws what the timelapse does asleep with
+// the display off.
+
 #include <avr/io.h>
-#include <util/delay.h>
 #include <avr/interrupt.h>
-
-#define LED_PIN					PB4
-#define BUTTON_PIN				PB3
-#define HPERIOD					10
-#define NPULSES					40
-
-#define SHUT_INSTANT			7330
-#define SHUT_DELAYED			5360
-
-void send_pulses();
-void shoot_camera();
-
-volatile uint8_t _shoot = 0;
-
-ISR(PCINT0_vect) {
-	cli();
-	if (!(PINB & (1 << BUTTON_PIN))) {
-		_shoot = 1;
-	}
-	sei();
+#include <avr/power.h>
+#include <avr/sleep.h>
+
+#include "../board.h"
+#include "../ir.h"
+#include "../wait.h"
+
+#define DEBOUNCE_US                         20000       // contact bounce of the button
+
+EMPTY_INTERRUPT(PCINT0_vect);               // only wakes, the loop reads the pin
+
+// power-down until the button is pressed, or released; the pin change
+// interrupt wakes on either edge, bounces included
+static void sleep_until(bool pressed) {
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    cli();
+    while (ButtonPin::is_low() != pressed) {
+        sleep_enable();
+#ifdef sleep_bod_disable
+        sleep_bod_disable();
+#endif
+        sei();
+        sleep_cpu();
+        sleep_disable();
+        cli();
+    }
+    sei();
 }
 
-void shoot_camera() {
-	send_pulses();
-	_delay_us(SHUT_INSTANT);
-	send_pulses();
-}
-
-void send_pulses() {
-	uint8_t i = 0;
-	for(i = 0; i < NPULSES; i++) {
-		PORTB ^= (1 << LED_PIN);
-		_delay_us(HPERIOD);
-	}
-	PORTB &= ~(1 << LED_PIN);
-}
-
-/*
-void _delay_using_timer(uint16_t us) {
-	uint8_t _bits_prescaler = 0x00;
-	if (us > 255) {
-		OCR0A = us / 256;					// actual only if F_CPU = 1MHz
-		_bits_prescaler = (1 << CS02);
-	} else {
-		OCR0A = us;							// actual only if F_CPU = 1MHz
-		_bits_prescaler = (1 << CS00);
-	}
-	TCCR0B = _bits_prescaler;
-	TCCR0A = (1 << WGM01);					// CTC mode
-	while (!(TIFR & (1 << OCF0A))) {};
-	TIFR |= (1 << OCF0A);
-	TCCR0B &= ~(_bits_prescaler);			// stop timer
-}
-*/
 int main() {
-	DDRB = 0xFF & ~(1 << BUTTON_PIN);
-	PORTB = 0x00 | (1 << BUTTON_PIN);
-	PCMSK |= (1 << PCINT3);               // enable PCINT3
-	sei();
-	GIMSK |= (1 << PCIE);                 // enable global pc interrupts
-	while(true) {
-		if (_shoot) {
-			GIMSK &= ~(1 << PCIE);
-			shoot_camera();
-			_shoot = 0;
-			GIMSK = (1 << PCIE);
-		}
-	}
-	return 0;
+    MCUSR &= ~(1 << WDRF);
+    WDTCR |= (1 << WDCE) | (1 << WDE);
+    WDTCR = 0x00;
+    ButtonPin::port_t::ddr() = 0xFF & ~ButtonPin::mask;  // unused pins driven low
+    ButtonPin::port_t::port() = 0x00 | ButtonPin::mask;
+    ADCSRA &= ~(1 << ADEN);
+    ACSR |= (1 << ACD);
+    power_adc_disable();
+    power_timer0_disable();                 // wait_us() turns it on for a wait
+    power_timer1_disable();
+    power_usi_disable();
+    PCMSK |= ButtonPin::mask;
+    GIMSK |= (1 << PCIE);
+    sei();
+    while (true) {
+        sleep_until(true);
+        wait_us(DEBOUNCE_US);
+        if (ButtonPin::is_low()) {
+            ir_release(false);
+        }
+        sleep_until(false);
+        wait_us(DEBOUNCE_US);
+    }
+    return 0;
 }
@@ -0,0 +1,190 @@
+// Cycle and size benchmark of the firmware hot paths. Runs a firmware .elf
+// built with -D_BENCH_ in simavr, selects the 1 s interval with one button
+// press and runs it for a while. Every call of the functions below is timed
+// from entry until the return pops its frame, in awake cycles, so time spent
+// in power-down does not count. Calls are inclusive of whatever they call
+// and of interrupts taken inside them. "main_loop" is one pass from wake-up
+// to the next sleep. Prints one JSON object per run.
+//
+// Usage: bench [--mcu NAME] [--f-cpu HZ] [--seconds N] [--variant NAME]
+//              firmware.elf symbols.txt
+//
+// symbols.txt is 'avr-nm -S -C --defined-only firmware.elf', see bench.sh.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "sim.h"
+
+#define PRESS_AT_MS                         100
+#define SPL                                 0x5D        // data space addresses
+#define SPH                                 0x5E
+
+static const char* hot_paths[] = {
+    "shift", "wdt_enable", "wdt_disable", "_power_sleep", "send_pulses", "shoot_camera",
+    "wait_idle",                            // measures the WAIT_IDLE_* estimates of wait.h
+};
+
+struct timing {
+    std::string name;
+    unsigned size = 0;
+    unsigned long calls = 0;
+    avr_cycle_count_t min = 0, max = 0, total = 0;
+
+    void add(avr_cycle_count_t cycles) {
+        min = !calls || cycles < min ? cycles : min;
+        max = cycles > max ? cycles : max;
+        total += cycles;
+        calls++;
+    }
+};
+
+struct frame {
+    timing* fn;
+    uint16_t sp;
+    avr_cycle_count_t start;
+};
+
+// entry byte address -> function, from the avr-nm listing
+static bool load_symbols(const char* path, const board& b, std::map<uint32_t, timing>& fns) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    char vectors[3][16];
+    snprintf(vectors[0], sizeof(vectors[0]), "__vector_%d", b.pcint_vector);
+    snprintf(vectors[1], sizeof(vectors[1]), "__vector_%d", b.wdt_vector);
+    snprintf(vectors[2], sizeof(vectors[2]), "__vector_%d", b.timer0_vector);
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned addr, size;
+        char type, name[200];
+        if (sscanf(line, "%x %x %c %199[^(\n]", &addr, &size, &type, name) != 4 ||
+            (type != 'T' && type != 't')) {
+            continue;
+        }
+        std::string label;
+        if (!strcmp(name, vectors[0])) {
+            label = "ISR(PCINT0_vect)";
+        } else if (!strcmp(name, vectors[1])) {
+            label = "ISR(WDT_vect)";
+        } else if (!strcmp(name, vectors[2])) {
+            label = "ISR(TIMER0_COMPA_vect)";
+        } else {
+            for (const char* hot : hot_paths) {
+                if (!strcmp(name, hot)) {
+                    label = hot;
+                }
+            }
+        }
+        if (!label.empty()) {
+            timing& t = fns[addr];
+            t.name = label;
+            t.size = size;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static void json(const char* name, const timing& t, bool last) {
+    printf("    \"%s\": {\"size\": %u, \"calls\": %lu, \"min\": %llu, \"max\": %llu, "
+           "\"mean\": %.1f}%s\n", name, t.size, t.calls, (unsigned long long)t.min,
+           (unsigned long long)t.max, t.calls ? (double)t.total / t.calls : 0.0, last ? "" : ",");
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [--mcu NAME] [--f-cpu HZ] [--seconds N] [--variant NAME] "
+                    "firmware.elf symbols.txt\n", name);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    const char* mcu = "attiny45";
+    uint32_t f_cpu = 1000000;
+    unsigned seconds = 15;
+    const char* variant = "default";
+    const char* files[2] = { NULL, NULL };
+    int nfiles = 0;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' && nfiles < 2) {
+            files[nfiles++] = argv[i];
+        } else if (i + 1 >= argc) {
+            usage(argv[0]);
+        } else if (!strcmp(argv[i], "--mcu")) {
+            mcu = argv[++i];
+        } else if (!strcmp(argv[i], "--f-cpu")) {
+            f_cpu = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--seconds")) {
+            seconds = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--variant")) {
+            variant = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (nfiles != 2) {
+        usage(argv[0]);
+    }
+    const char* elf = files[0];
+    board b;
+    std::map<uint32_t, timing> fns;
+    if (!find_board(mcu, elf, b) || !load_symbols(files[1], b, fns)) {
+        return 2;
+    }
+    avr_t* avr = sim_load(elf, b, f_cpu);
+    if (!avr) {
+        return 2;
+    }
+
+    button_script button(avr, b, 1, PRESS_AT_MS);
+    avr_cycle_count_t limit = (avr_cycle_count_t)f_cpu * seconds;
+    avr_cycle_count_t awake = 0;            // cycles not spent sleeping
+    avr_cycle_count_t woke = 0;
+    bool sleeping = false;
+    timing main_loop;
+    std::vector<frame> stack;
+    while (avr->cycle < limit) {
+        uint16_t sp = avr->data[SPL] | (avr->data[SPH] << 8);
+        auto fn = fns.find(avr->pc);
+        if (fn != fns.end()) {
+            stack.push_back({ &fn->second, sp, awake });
+        }
+        button.step(avr);
+        bool was_running = avr->state == cpu_Running;
+        avr_cycle_count_t before = avr->cycle;
+        if (!sim_step(avr, elf)) {
+            return 1;
+        }
+        if (was_running) {
+            awake += avr->cycle - before;
+        }
+        if (!sleeping && avr->state == cpu_Sleeping) {
+            main_loop.add(awake - woke);
+            sleeping = true;
+        } else if (sleeping && avr->state == cpu_Running) {
+            woke = awake;
+            sleeping = false;
+        }
+        sp = avr->data[SPL] | (avr->data[SPH] << 8);
+        while (!stack.empty() && sp > stack.back().sp) {
+            stack.back().fn->add(awake - stack.back().start);
+            stack.pop_back();
+        }
+    }
+
+    printf("{\n  \"variant\": \"%s\", \"mcu\": \"%s\", \"f_cpu\": %lu, \"seconds\": %u,\n",
+           variant, mcu, (unsigned long)f_cpu, seconds);
+    printf("  \"functions\": {\n");
+    for (const auto& fn : fns) {
+        json(fn.second.name.c_str(), fn.second, false);
+    }
+    json("main_loop", main_loop, true);
+    printf("  }\n}\n");
+    return 0;
+}
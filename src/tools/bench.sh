@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# Builds main.cpp once per variant with the flags of lufa_build.mk plus
+# -D_BENCH_, runs each build through bench and writes the reports as a JSON
+# array to bench.json (or $OUT). Diff two reports to see what a change cost.
+#
+# Needs avr-gcc, avr-nm and the bench tool (make bench). Usage:
+# tools/bench.sh [MCU [F_CPU]]
+#
+
+cd "$(dirname "$0")" || exit 1
+MCU=${1:-attiny45}
+F_CPU=${2:-1000000}
+OUT=${OUT:-bench.json}
+TMP=${TMPDIR:-/tmp}/bench.$$
+CFLAGS="-mmcu=$MCU -DF_CPU=${F_CPU}UL -Os -std=gnu++14 -fshort-enums -fno-inline-small-functions
+        -fpack-struct -fno-strict-aliasing -funsigned-char -funsigned-bitfields -ffunction-sections
+        -Wl,--gc-sections -Wl,--relax -D_BENCH_"
+
+VARIANTS="default util-delay eeprom catode"
+flags() {
+    case $1 in
+    util-delay) echo -D_USE_UTIL_DELAY ;;
+    eeprom)     echo -D_USE_EEPROM_ ;;
+    catode)     echo -D_COMMON_CATODE_ ;;
+    esac
+}
+
+mkdir -p $TMP || exit 1
+trap 'rm -rf $TMP' EXIT
+SEP="["
+for V in $VARIANTS; do
+    echo " [BENCH]    : $MCU $V" >&2
+    avr-gcc $CFLAGS $(flags $V) -x c++ ../main.cpp -o $TMP/$V.elf || exit 1
+    avr-nm -S -C --defined-only $TMP/$V.elf > $TMP/$V.sym || exit 1
+    echo "$SEP" >> $TMP/report
+    ./bench --mcu $MCU --f-cpu $F_CPU --variant $V $TMP/$V.elf $TMP/$V.sym >> $TMP/report || exit 1
+    SEP=","
+done
+echo "]" >> $TMP/report
+mv $TMP/report $OUT && echo " [BENCH]    : $OUT" >&2
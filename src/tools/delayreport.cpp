@@ -0,0 +1,88 @@
+// Prints how wait.h and delay.h plan each firmware delay for a range of F_CPU
+// values: cycles, IDLE turns of Timer0 or the loop primitive, and the error
+// against the requested time. Lines marked REJECT are delays that would fail
+// to compile at that clock.
+// Usage: delayreport [F_CPU]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../delay.h"
+#include "../ir.h"
+#include "../wait.h"
+
+struct named_delay {
+    const char* name;
+    double      us;
+    bool        wait;                               // wait_us(), else delay_us()
+};
+
+static const named_delay delays[] = {
+    { "HPERIOD",        HPERIOD,                                        false },
+    { "timer burst",    (NPULSES - 1) * 1000000.0 / (2 * CARRIER_HZ),   true },
+    { "blink",          300,                                            true },  // SHOT_BLINK_US
+    { "SHUT_DELAYED",   SHUT_DELAYED,                                   true },
+    { "SHUT_INSTANT",   SHUT_INSTANT,                                   true },
+    { "release hold",   100000,                                         true },  // RELEASE_HOLD_US
+};
+
+static const uint32_t clocks[] = {
+    128000, 1000000, 1200000, 4800000, 8000000, 9600000, 16000000, 20000000
+};
+
+static void describe(uint32_t n, char* out, size_t size) {
+    switch (delay::kind(n)) {
+    case delay::NOPS:
+        snprintf(out, size, "%lu nop", (unsigned long)n);
+        return;
+    case delay::LOOP1:
+        snprintf(out, size, "LOOP1 x%u +%lu nop", delay::loop1_turns(n), (unsigned long)delay::rest(n));
+        return;
+    case delay::LOOP2:
+        snprintf(out, size, "LOOP2 x%u +%lu nop", delay::loop2_turns(n), (unsigned long)delay::rest(n));
+        return;
+    default: {
+        char tail[64];
+        describe(delay::rest(n), tail, sizeof(tail));
+        snprintf(out, size, "CHAINED %ux%u + %s", delay::chained_outer(n), delay::chained_inner(n), tail);
+        return;
+    }
+    }
+}
+
+static void describe_wait(uint32_t n, char* out, size_t size) {
+    if (wait::kind(n) == wait::BUSY) {
+        describe(n, out, size);
+        return;
+    }
+    uint8_t cs = wait::best(n);
+    char tail[64];
+    describe(wait::rest(n), tail, sizeof(tail));
+    snprintf(out, size, "IDLE /%u %lux%u + %s", wait::prescale(cs),
+             (unsigned long)wait::turns(n, cs), wait::count(n, cs), tail);
+}
+
+int main(int argc, char** argv) {
+    int rejected = 0;
+    printf("%-9s %-13s %8s %9s %10s  %s\n", "F_CPU", "delay", "us", "cycles", "error ppm", "plan");
+    for (uint32_t f_cpu : clocks) {
+        if (argc > 1 && strtoul(argv[1], NULL, 10) != f_cpu) {
+            continue;
+        }
+        for (const named_delay& d : delays) {
+            uint32_t n = delay::cycles(d.us, f_cpu);
+            uint32_t ppm = delay::error_ppm(d.us, f_cpu);
+            char plan[96];
+            if (d.wait) {
+                describe_wait(n, plan, sizeof(plan));
+            } else {
+                describe(n, plan, sizeof(plan));
+            }
+            bool ok = n > 0 && n <= DELAY_MAX_CYCLES && ppm <= DELAY_TOLERANCE_PPM;
+            rejected += !ok;
+            printf("%-9lu %-13s %8.0f %9lu %10lu  %s%s\n", (unsigned long)f_cpu, d.name, d.us,
+                   (unsigned long)n, (unsigned long)ppm, ok ? "" : "REJECT ", plan);
+        }
+    }
+    // only a single clock makes a rejected delay an error
+    return argc > 1 && rejected ? 1 : 0;
+}
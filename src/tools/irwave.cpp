@@ -0,0 +1,260 @@
+// Golden IR-waveform validator. Runs a built firmware .elf in simavr, selects
+// the 1 s interval with one button press, captures the LED pin edges of the
+// first shot with their cycle timestamps and compares carrier frequency, duty
+// cycle, pulses, burst length and gap against a protocol of irgolden.txt.
+// With --eeprom the EEPROM starts with an image of tools/preset instead and
+// nothing is pressed, so a -D_PRESET_ build runs the preset's protocol.
+//
+// Usage: irwave [--mcu NAME] [--f-cpu HZ] [--protocol NAME] [--golden FILE]
+//               [--edges FILE] [--eeprom FILE.eep] firmware.elf
+//
+// Needs simavr (libsimavr and its headers); its timer OC pin output drives
+// the ioport, so the Timer1 carrier of the ATtiny2313A is captured as well.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "sim.h"
+#include <simavr/avr_eeprom.h>
+
+#define BURST_GAP_US                        1000        // longer is the next burst
+#define PRESS_AT_MS                         100
+#define RUN_LIMIT_S                         20          // 5 s display timeout + 1 s interval
+
+struct golden {
+    char        protocol[32];
+    double      carrier_hz, carrier_tol;
+    double      duty, duty_tol;
+    unsigned    pulses;
+    double      burst_us, burst_tol;
+    double      gap_us, gap_tol;
+};
+
+struct edge {
+    avr_cycle_count_t cycle;
+    uint32_t level;
+};
+
+static std::vector<edge> _edges;
+static unsigned _bursts;
+static avr_cycle_count_t _burst_gap;        // BURST_GAP_US in cycles
+
+static void led_changed(avr_irq_t* irq, uint32_t value, void* param) {
+    avr_t* avr = (avr_t*)param;
+    if (!_edges.empty() && _edges.back().level == value) {
+        return;
+    }
+    if (_edges.empty() || avr->cycle - _edges.back().cycle > _burst_gap) {
+        _bursts++;
+    }
+    _edges.push_back({ avr->cycle, value });
+}
+
+static bool load_golden(const char* path, const char* protocol, golden& g) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') {
+            continue;
+        }
+        if (sscanf(line, "%31s %lf %lf %lf %lf %u %lf %lf %lf %lf", g.protocol, &g.carrier_hz,
+                   &g.carrier_tol, &g.duty, &g.duty_tol, &g.pulses, &g.burst_us, &g.burst_tol,
+                   &g.gap_us, &g.gap_tol) == 10 && !strcmp(g.protocol, protocol)) {
+            fclose(f);
+            return true;
+        }
+    }
+    fclose(f);
+    fprintf(stderr, "%s: no protocol %s\n", path, protocol);
+    return false;
+}
+
+// Bursts as [first, last] edge indexes, split where the LED idles longer
+// than BURST_GAP_US.
+static std::vector<std::pair<size_t, size_t> > bursts() {
+    std::vector<std::pair<size_t, size_t> > result;
+    for (size_t i = 0; i < _edges.size(); i++) {
+        if (result.empty() || _edges[i].cycle - _edges[i - 1].cycle > _burst_gap) {
+            result.push_back({ i, i });
+        } else {
+            result.back().second = i;
+        }
+    }
+    return result;
+}
+
+// Intel HEX EEPROM image, as tools/preset writes it, into `ee`.
+static bool load_eeprom(const char* path, std::vector<uint8_t>& ee) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    char line[128];
+    bool ok = false;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned n, addr, type, byte;
+        if (sscanf(line, ":%2x%4x%2x", &n, &addr, &type) != 3 || strlen(line) < 11 + 2 * n) {
+            break;
+        }
+        if (type == 1) {
+            ok = true;
+            break;
+        }
+        if (type != 0) {
+            break;
+        }
+        if (ee.size() < addr + n) {
+            ee.resize(addr + n, 0xFF);
+        }
+        for (unsigned i = 0; i < n && sscanf(line + 9 + 2 * i, "%2x", &byte) == 1; i++) {
+            ee[addr + i] = byte;
+        }
+    }
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "%s: not an Intel HEX image\n", path);
+    }
+    return ok;
+}
+
+static bool check(const char* what, double value, double expected, double tol, bool points,
+                  const char* unit) {
+    double deviation = points ? value - expected : (value - expected) / expected * 100;
+    bool ok = fabs(deviation) <= tol;
+    printf("%-10s %12.2f %-3s expected %10.2f +-%g%s, %+7.2f%s  %s\n", what, value, unit,
+           expected, tol, points ? "" : "%", deviation, points ? "" : "%", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [--mcu NAME] [--f-cpu HZ] [--protocol NAME] [--golden FILE] "
+                    "[--edges FILE] [--eeprom FILE.eep] firmware.elf\n", name);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    const char* mcu = "attiny45";
+    uint32_t f_cpu = 1000000;
+    const char* protocol = "canon-instant";
+    const char* golden_file = "irgolden.txt";
+    const char* edges_file = NULL;
+    const char* eeprom_file = NULL;
+    const char* elf = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' && !elf) {
+            elf = argv[i];
+        } else if (i + 1 >= argc) {
+            usage(argv[0]);
+        } else if (!strcmp(argv[i], "--mcu")) {
+            mcu = argv[++i];
+        } else if (!strcmp(argv[i], "--f-cpu")) {
+            f_cpu = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--protocol")) {
+            protocol = argv[++i];
+        } else if (!strcmp(argv[i], "--golden")) {
+            golden_file = argv[++i];
+        } else if (!strcmp(argv[i], "--edges")) {
+            edges_file = argv[++i];
+        } else if (!strcmp(argv[i], "--eeprom")) {
+            eeprom_file = argv[++i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!elf) {
+        usage(argv[0]);
+    }
+    board b;
+    golden g;
+    if (!find_board(mcu, elf, b) || !load_golden(golden_file, protocol, g)) {
+        return 2;
+    }
+    std::vector<uint8_t> ee;
+    if (eeprom_file && !load_eeprom(eeprom_file, ee)) {
+        return 2;
+    }
+    avr_t* avr = sim_load(elf, b, f_cpu);
+    if (!avr) {
+        return 2;
+    }
+    if (!ee.empty()) {
+        avr_eeprom_desc_t desc = { ee.data(), 0, (uint32_t)ee.size() };
+        avr_ioctl(avr, AVR_IOCTL_EEPROM_SET, &desc);
+    }
+    _burst_gap = (avr_cycle_count_t)f_cpu * BURST_GAP_US / 1000000;
+    avr_irq_register_notify(led_irq(avr, b), led_changed, avr);
+
+    // one press selects the 1 s interval; the shot follows the display timeout.
+    // A preset starts its program at power-on without a press.
+    button_script button(avr, b, eeprom_file ? 0 : 1, PRESS_AT_MS);
+    avr_cycle_count_t limit = (avr_cycle_count_t)f_cpu * RUN_LIMIT_S;
+    while (avr->cycle < limit && _bursts < 3) {
+        button.step(avr);
+        if (!sim_step(avr, elf)) {
+            return 1;
+        }
+    }
+
+    if (edges_file) {
+        FILE* f = fopen(edges_file, "w");
+        if (!f) {
+            perror(edges_file);
+            return 2;
+        }
+        fprintf(f, "cycle,time_us,level\n");
+        for (const edge& e : _edges) {
+            fprintf(f, "%llu,%.3f,%u\n", (unsigned long long)e.cycle, e.cycle * 1e6 / f_cpu,
+                    e.level);
+        }
+        fclose(f);
+    }
+
+    std::vector<std::pair<size_t, size_t> > shot = bursts();
+    if (shot.size() < 2) {
+        printf("%s: %zu burst(s) in %d s, no shot to compare\n", elf, shot.size(), RUN_LIMIT_S);
+        return 1;
+    }
+
+    // carrier and duty from every full period of both bursts
+    double us_per_cycle = 1e6 / f_cpu;
+    double periods = 0, period_us = 0, high_us = 0;
+    unsigned pulses[2] = { 0, 0 };
+    for (int k = 0; k < 2; k++) {
+        for (size_t i = shot[k].first; i <= shot[k].second; i++) {
+            if (!_edges[i].level) {
+                continue;
+            }
+            pulses[k]++;
+            if (i + 2 <= shot[k].second) {
+                periods++;
+                period_us += (_edges[i + 2].cycle - _edges[i].cycle) * us_per_cycle;
+                high_us += (_edges[i + 1].cycle - _edges[i].cycle) * us_per_cycle;
+            }
+        }
+    }
+    double carrier = periods ? periods / period_us * 1e6 : 0;
+    double duty = period_us ? high_us / period_us * 100 : 0;
+    double burst = (_edges[shot[0].second].cycle - _edges[shot[0].first].cycle) * us_per_cycle;
+    double gap = (_edges[shot[1].first].cycle - _edges[shot[0].second].cycle) * us_per_cycle;
+
+    printf("%s on %s at %lu Hz against %s\n", elf, mcu, (unsigned long)f_cpu, g.protocol);
+    bool ok = check("carrier", carrier, g.carrier_hz, g.carrier_tol, false, "Hz");
+    ok &= check("duty", duty, g.duty, g.duty_tol, true, "%");
+    ok &= check("burst", burst, g.burst_us, g.burst_tol, false, "us");
+    ok &= check("gap", gap, g.gap_us, g.gap_tol, false, "us");
+    for (int k = 0; k < 2; k++) {
+        bool same = pulses[k] == g.pulses;
+        printf("pulses %d   %12u     expected %10u           %s\n", k + 1, pulses[k], g.pulses,
+               same ? "ok" : "FAIL");
+        ok &= same;
+    }
+    return ok ? 0 : 1;
+}
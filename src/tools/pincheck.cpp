@@ -0,0 +1,46 @@
+// Probes for pincheck.sh. Each tpl_* function performs one Pin<> operation,
+// its mac_* twin the same operation written the way main.cpp did before the
+// templates, MAKE_LOW/MAKE_HIGH on PORTB and a PINB test with the pin number
+// of the board. The static_asserts keep the two on the same pin.
+
+#include <avr/io.h>
+#include "../board.h"
+
+#define MAKE_LOW(X, Y)                      X &= ~(1 << Y)
+#define MAKE_HIGH(X, Y)                     X |= (1 << Y)
+
+#define PROBE                               extern "C" __attribute__((noinline, used)) void
+
+#if defined(__AVR_ATtiny2313A__)
+#define BUTTON_PIN                          PB1
+#define LED_PIN                             PB3
+#else
+#define BUTTON_PIN                          PB3
+#define LED_PIN                             PB4
+#endif
+
+template <class Port> constexpr bool on_port_b() { return false; }
+template <> constexpr bool on_port_b<PortB>() { return true; }
+
+static_assert(on_port_b<LedPin::port_t>() && LedPin::bit == LED_PIN, "LED_PIN is not LedPin");
+static_assert(on_port_b<ButtonPin::port_t>() && ButtonPin::bit == BUTTON_PIN, "BUTTON_PIN is not ButtonPin");
+
+PROBE tpl_high() { LedPin::high(); }
+PROBE mac_high() { MAKE_HIGH(PORTB, LED_PIN); }
+
+PROBE tpl_low() { LedPin::low(); }
+PROBE mac_low() { MAKE_LOW(PORTB, LED_PIN); }
+
+PROBE tpl_toggle() { LedPin::toggle(); }
+PROBE mac_toggle() { PORTB ^= (1 << LED_PIN); }
+
+PROBE tpl_test() {
+    if (ButtonPin::is_low()) {
+        LedPin::high();
+    }
+}
+PROBE mac_test() {
+    if (!(PINB & (1 << BUTTON_PIN))) {
+        MAKE_HIGH(PORTB, LED_PIN);
+    }
+}
@@ -0,0 +1,55 @@
+#!/bin/sh
+#
+# Compiles pincheck.cpp for every supported MCU and compares the Pin<>
+# probes with the macro probes instruction by instruction. Fails when a
+# template probe is larger or slower than its macro twin, or when high(),
+# low() and is_low() did not become a single sbi, cbi and sbis/sbic.
+#
+# Needs avr-gcc and avr-objdump in PATH. Usage: tools/pincheck.sh [MCU...]
+#
+
+cd "$(dirname "$0")" || exit 1
+MCUS=${*:-"attiny45 attiny13a attiny2313a"}
+OBJ=${TMPDIR:-/tmp}/pincheck.$$.o
+STATUS=0
+
+for MCU in $MCUS; do
+    avr-gcc -mmcu=$MCU -Os -std=gnu++14 -fno-inline-small-functions -c pincheck.cpp -o $OBJ || exit 1
+    echo " [PINCHECK]: $MCU"
+    avr-objdump -d $OBJ | awk '
+        # cycles of the instructions the probes can compile to (taken branch)
+        BEGIN {
+            split("sbi:2 cbi:2 sbis:2 sbic:2 in:1 out:1 ldi:1 eor:1 ori:1 andi:1 or:1 and:1 com:1 rjmp:2 ret:4", t, " ")
+            for (i in t) { split(t[i], kv, ":"); cyc[kv[1]] = kv[2] }
+        }
+        /^[0-9a-f]+ <[a-z_]+>:$/ {
+            fn = substr($2, 2, length($2) - 3)
+            order[++n] = fn
+            next
+        }
+        /^ +[0-9a-f]+:\t/ && fn != "" {
+            split($0, f, "\t")
+            split(f[3], m, " ")
+            if (m[1] == "ret") { next }
+            bytes[fn] += split(f[2], hx, " ")
+            cycles[fn] += (m[1] in cyc) ? cyc[m[1]] : 4
+            ops[fn] = ops[fn] (ops[fn] == "" ? "" : " ") m[1]
+        }
+        END {
+            bad = 0
+            for (i = 1; i <= n; i++) {
+                fn = order[i]
+                if (fn !~ /^tpl_/) { continue }
+                mac = "mac_" substr(fn, 5)
+                printf "   %-12s %2d/%2d bytes %2d/%2d cycles   %s\n", substr(fn, 5), bytes[fn], bytes[mac], cycles[fn], cycles[mac], ops[fn]
+                if (bytes[fn] > bytes[mac] || cycles[fn] > cycles[mac]) { bad = 1; print "   ^ larger than the macro form" }
+                if (fn == "tpl_high" && ops[fn] != "sbi") { bad = 1; print "   ^ expected a single sbi" }
+                if (fn == "tpl_low" && ops[fn] != "cbi") { bad = 1; print "   ^ expected a single cbi" }
+                if (fn == "tpl_test" && ops[fn] !~ /^sbi[cs] /) { bad = 1; print "   ^ expected sbis/sbic" }
+            }
+            exit bad
+        }' || STATUS=1
+done
+
+rm -f $OBJ
+exit $STATUS
@@ -0,0 +1,156 @@
+// Compiles a boot preset, see preset.h, into an Intel HEX EEPROM image for
+// a -D_PRESET_ build, optionally with the shooting sequence the 'P' setting
+// of a -D_SEQUENCE_ build runs. Every unit flashed with the image starts
+// the same program at power-on. --at and --sequence-at are the EEPROM
+// addresses of _preset and _sequence, 'make preset' looks them up.
+//
+// Usage: preset --interval I [--protocol instant|delayed] [--frames N]
+//               [--start DURATION] [--at ADDR] [--sequence FILE
+//               --sequence-at ADDR --sequence-size BYTES] [out.eep]
+//
+// I is a setting of cycles.md as 1s..9s or 1m..8m, or P for the sequence.
+
+#include "seqasm.h"
+#include "../preset.h"
+
+#define HEX_RECORD                          16
+
+// cycles.md, in seconds, by durations[] index; 0 is "disabled"
+static const unsigned nominal[] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 60, 120, 180, 240, 300, 360, 420, 480
+};
+#define SETTINGS                            (sizeof(nominal) / sizeof(nominal[0]))
+#define SEQUENCE_SETTING                    SETTINGS    // 'P' follows 'h'
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s --interval I [--protocol instant|delayed] [--frames N] "
+                    "[--start DURATION] [--at ADDR] [--sequence FILE --sequence-at ADDR "
+                    "--sequence-size BYTES] [out.eep]\n", name);
+    exit(2);
+}
+
+static void hex_record(FILE* f, uint8_t type, uint16_t addr, const uint8_t* data, size_t n) {
+    uint8_t sum = n + (addr >> 8) + addr + type;
+    fprintf(f, ":%02X%04X%02X", (unsigned)n, addr, type);
+    for (size_t i = 0; i < n; i++) {
+        fprintf(f, "%02X", data[i]);
+        sum += data[i];
+    }
+    fprintf(f, "%02X\n", (uint8_t)-sum);
+}
+
+static void hex_block(FILE* f, uint16_t addr, const uint8_t* data, size_t n) {
+    for (size_t i = 0; i < n; i += HEX_RECORD) {
+        hex_record(f, 0x00, addr + i, data + i, n - i < HEX_RECORD ? n - i : HEX_RECORD);
+    }
+}
+
+static bool read_file(const char* path, std::string& text) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    char buf[256];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0; ) {
+        text.append(buf, n);
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    preset p = preset();
+    p.version = PRESET_VERSION;
+    p.protocol = PRESET_INSTANT;
+    unsigned long at = 0, sequence_at = 0, sequence_size = 0;
+    const char* sequence_file = NULL;
+    const char* out_file = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' && !out_file) {
+            out_file = argv[i];
+            continue;
+        } else if (i + 1 >= argc) {
+            usage(argv[0]);
+        }
+        const char* opt = argv[i];
+        const char* arg = argv[++i];
+        double ms;
+        long n;
+        if (!strcmp(opt, "--interval")) {
+            if (!strcmp(arg, "P")) {
+                p.setting = SEQUENCE_SETTING;
+            } else if (seq_duration(arg, ms)) {
+                for (uint8_t s = 1; s < SETTINGS; s++) {
+                    p.setting = nominal[s] * 1000 == ms ? s : p.setting;
+                }
+            }
+            if (!p.setting) {
+                fprintf(stderr, "%s: no setting runs every %s\n", argv[0], arg);
+                return 2;
+            }
+        } else if (!strcmp(opt, "--protocol") && !strcmp(arg, "instant")) {
+            p.protocol = PRESET_INSTANT;
+        } else if (!strcmp(opt, "--protocol") && !strcmp(arg, "delayed")) {
+            p.protocol = PRESET_DELAYED;
+        } else if (!strcmp(opt, "--frames") && seq_number(arg, 0, 65535, n)) {
+            p.frames = n;
+        } else if (!strcmp(opt, "--start") && seq_duration(arg, ms) && ms >= 0 && ms / 1000 <= 65535) {
+            p.start_s = (uint16_t)(ms / 1000 + 0.999);
+        } else if (!strcmp(opt, "--at")) {
+            at = strtoul(arg, NULL, 0) & 0xFFFF;                    // avr-nm adds 0x810000
+        } else if (!strcmp(opt, "--sequence")) {
+            sequence_file = arg;
+        } else if (!strcmp(opt, "--sequence-at")) {
+            sequence_at = strtoul(arg, NULL, 0) & 0xFFFF;
+        } else if (!strcmp(opt, "--sequence-size")) {
+            sequence_size = strtoul(arg, NULL, 0);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!p.setting) {
+        usage(argv[0]);
+    }
+    if (p.setting == SEQUENCE_SETTING && p.start_s) {
+        fprintf(stderr, "%s: start the sequence with a wait instead of --start\n", argv[0]);
+        return 2;
+    }
+    if (p.setting == SEQUENCE_SETTING && p.frames) {
+        fprintf(stderr, "%s: end the sequence with until instead of --frames\n", argv[0]);
+        return 2;
+    }
+    if (p.setting == SEQUENCE_SETTING && !sequence_file) {
+        fprintf(stderr, "%s: note, P runs the sequence already in the units' EEPROM\n", argv[0]);
+    }
+    p.check = preset_check(p);
+
+    std::vector<uint8_t> code;
+    if (sequence_file) {
+        std::string source, error;
+        if (!read_file(sequence_file, source)) {
+            return 1;
+        }
+        if (!seq_assemble(source, code, error)) {
+            fprintf(stderr, "%s: %s\n", sequence_file, error.c_str());
+            return 1;
+        }
+        if (!sequence_size || code.size() > sequence_size) {
+            fprintf(stderr, "%s: %zu bytes, --sequence-size is %lu\n", sequence_file,
+                    code.size(), sequence_size);
+            return 1;
+        }
+    }
+
+    FILE* out = out_file ? fopen(out_file, "w") : stdout;
+    if (!out) {
+        perror(out_file);
+        return 1;
+    }
+    hex_block(out, at, (const uint8_t*)&p, sizeof(p));
+    if (!code.empty()) {
+        hex_block(out, sequence_at, code.data(), code.size());
+    }
+    hex_record(out, 0x01, 0, NULL, 0);
+    return out == stdout || !fclose(out) ? 0 : 1;
+}
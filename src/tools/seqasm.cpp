@@ -0,0 +1,91 @@
+// Assembles a shooting sequence, see seqasm.h for the syntax, into an Intel
+// HEX EEPROM image for avrdude. --at is the EEPROM address of _sequence in
+// the firmware, --size its SEQUENCE_SIZE; 'make sequence' looks both up.
+//
+// Usage: seqasm [--at ADDR] [--size BYTES] [--list] source.seq [out.eep]
+
+#include "seqasm.h"
+
+#define HEX_RECORD                          16
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [--at ADDR] [--size BYTES] [--list] source.seq [out.eep]\n", name);
+    exit(2);
+}
+
+static void hex_record(FILE* f, uint8_t type, uint16_t addr, const uint8_t* data, size_t n) {
+    uint8_t sum = n + (addr >> 8) + addr + type;
+    fprintf(f, ":%02X%04X%02X", (unsigned)n, addr, type);
+    for (size_t i = 0; i < n; i++) {
+        fprintf(f, "%02X", data[i]);
+        sum += data[i];
+    }
+    fprintf(f, "%02X\n", (uint8_t)-sum);
+}
+
+int main(int argc, char** argv) {
+    unsigned long at = 0;
+    unsigned long size = 128;
+    bool list = false;
+    const char* files[2] = { NULL, NULL };
+    int nfiles = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--list")) {
+            list = true;
+        } else if (argv[i][0] != '-' && nfiles < 2) {
+            files[nfiles++] = argv[i];
+        } else if (i + 1 >= argc) {
+            usage(argv[0]);
+        } else if (!strcmp(argv[i], "--at")) {
+            at = strtoul(argv[++i], NULL, 0) & 0xFFFF;  // avr-nm adds 0x810000
+        } else if (!strcmp(argv[i], "--size")) {
+            size = strtoul(argv[++i], NULL, 0);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (!nfiles) {
+        usage(argv[0]);
+    }
+
+    FILE* in = fopen(files[0], "r");
+    if (!in) {
+        perror(files[0]);
+        return 1;
+    }
+    std::string source;
+    char buf[256];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), in)) > 0; ) {
+        source.append(buf, n);
+    }
+    fclose(in);
+
+    std::vector<uint8_t> code;
+    std::string error;
+    if (!seq_assemble(source, code, error)) {
+        fprintf(stderr, "%s: %s\n", files[0], error.c_str());
+        return 1;
+    }
+    if (code.size() > size) {
+        fprintf(stderr, "%s: %zu bytes, SEQUENCE_SIZE is %lu\n", files[0], code.size(), size);
+        return 1;
+    }
+    if (list) {
+        for (size_t i = 0; i < code.size(); i++) {
+            fprintf(stderr, "%s%02X", i % HEX_RECORD ? " " : i ? "\n" : "", code[i]);
+        }
+        fprintf(stderr, "\n%zu of %lu bytes\n", code.size(), size);
+    }
+
+    FILE* out = nfiles > 1 ? fopen(files[1], "w") : stdout;
+    if (!out) {
+        perror(files[1]);
+        return 1;
+    }
+    for (size_t i = 0; i < code.size(); i += HEX_RECORD) {
+        size_t n = code.size() - i < HEX_RECORD ? code.size() - i : HEX_RECORD;
+        hex_record(out, 0x00, at + i, &code[i], n);
+    }
+    hex_record(out, 0x01, 0, NULL, 0);
+    return out == stdout || !fclose(out) ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+#ifndef _SEQASM_H_
+#define _SEQASM_H_
+
+// Assembler for the shooting sequences of sequence.h. One instruction per
+// line, '#' starts a comment, 'name:' labels the next instruction:
+//
+//    shoot                     - one frame
+//    wait DURATION             - sleep, DURATION a multiple of 250ms, as
+//                                250ms, 2s, 1.5m or 1h
+//    bulb DURATION             - open the shutter for DURATION
+//    set R N                   - counter R (0..3) = N (1..255)
+//    loop R LABEL              - decrement counter R, go to LABEL unless zero
+//    jump LABEL
+//    until FRAMES LABEL        - go to LABEL while fewer than FRAMES frames
+//                                were taken since the start, bulbs count one
+//    end
+//
+// Waits take the longest WDT period that divides them; longer than 255 of
+// those become several wait instructions.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../sequence.h"
+
+#define SEQ_MAX_PRESCALER                   9           // 8 sec
+
+struct seq_fixup {
+    size_t      at;
+    std::string label;
+    int         line;
+};
+
+// WDT prescaler p sleeps 250 ms << (p - 4), nominal
+static bool seq_wait(uint8_t op, double ms, std::vector<uint8_t>& out) {
+    long quarters = (long)(ms / 250 + 0.5);
+    if (quarters <= 0 || quarters * 250 - ms > 0.001 || ms - quarters * 250 > 0.001) {
+        return false;
+    }
+    uint8_t p = SEQ_MAX_PRESCALER;
+    while (quarters % (1L << (p - SEQ_MIN_PRESCALER))) {
+        p--;
+    }
+    long n = quarters >> (p - SEQ_MIN_PRESCALER);
+    if (op == SEQ_BULB && n > 255) {
+        return false;                       // the shutter would close in between
+    }
+    for (; n > 0; n -= 255) {
+        out.push_back(op | p);
+        out.push_back(n > 255 ? 255 : n);
+    }
+    return true;
+}
+
+static bool seq_duration(const char* text, double& ms) {
+    char* unit;
+    ms = strtod(text, &unit);
+    if (unit == text) {
+        return false;
+    }
+    if (!strcmp(unit, "ms")) {
+        return true;
+    } else if (!strcmp(unit, "s")) {
+        ms *= 1000;
+    } else if (!strcmp(unit, "m")) {
+        ms *= 60 * 1000;
+    } else if (!strcmp(unit, "h")) {
+        ms *= 60 * 60 * 1000;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool seq_number(const char* text, long lo, long hi, long& value) {
+    char* end;
+    value = strtol(text, &end, 0);
+    return end != text && !*end && value >= lo && value <= hi;
+}
+
+// assembles source into code, or returns false with the reason in error
+static bool seq_assemble(const std::string& source, std::vector<uint8_t>& code, std::string& error) {
+    std::map<std::string, size_t> labels;
+    std::vector<seq_fixup> fixups;
+    char message[160];
+    int line = 0;
+    code.clear();
+    for (size_t start = 0; start < source.size(); ) {
+        size_t end = source.find('\n', start);
+        if (end == std::string::npos) {
+            end = source.size();
+        }
+        std::string text = source.substr(start, end - start);
+        start = end + 1;
+        line++;
+        text = text.substr(0, text.find('#'));
+        std::vector<std::string> words;
+        for (char* w = strtok(&text[0], " \t\r"); w; w = strtok(NULL, " \t\r")) {
+            words.push_back(w);
+        }
+        while (!words.empty() && words[0].back() == ':') {
+            std::string label = words[0].substr(0, words[0].size() - 1);
+            if (labels.count(label)) {
+                snprintf(message, sizeof(message), "line %d: label '%s' defined twice", line, label.c_str());
+                error = message;
+                return false;
+            }
+            labels[label] = code.size();
+            words.erase(words.begin());
+        }
+        if (words.empty()) {
+            continue;
+        }
+        const std::string& op = words[0];
+        size_t args = words.size() - 1;
+        double ms;
+        long r, n;
+        bool ok;
+        if (op == "shoot" && args == 0) {
+            code.push_back(SEQ_SHOOT);
+            ok = true;
+        } else if (op == "end" && args == 0) {
+            code.push_back(SEQ_END);
+            ok = true;
+        } else if ((op == "wait" || op == "bulb") && args == 1) {
+            ok = seq_duration(words[1].c_str(), ms) &&
+                 seq_wait(op == "wait" ? SEQ_WAIT : SEQ_BULB, ms, code);
+        } else if (op == "set" && args == 2) {
+            ok = seq_number(words[1].c_str(), 0, SEQ_COUNTERS - 1, r) &&
+                 seq_number(words[2].c_str(), 1, 255, n);
+            if (ok) {
+                code.push_back(SEQ_SET | r);
+                code.push_back(n);
+            }
+        } else if (op == "loop" && args == 2) {
+            ok = seq_number(words[1].c_str(), 0, SEQ_COUNTERS - 1, r);
+            if (ok) {
+                code.push_back(SEQ_LOOP | r);
+                fixups.push_back({ code.size(), words[2], line });
+                code.push_back(0);
+            }
+        } else if (op == "jump" && args == 1) {
+            code.push_back(SEQ_JUMP);
+            fixups.push_back({ code.size(), words[1], line });
+            code.push_back(0);
+            ok = true;
+        } else if (op == "until" && args == 2) {
+            ok = seq_number(words[1].c_str(), 1, 65535, n);
+            if (ok) {
+                code.push_back(SEQ_UNTIL);
+                code.push_back(n & 0xFF);
+                code.push_back(n >> 8);
+                fixups.push_back({ code.size(), words[2], line });
+                code.push_back(0);
+            }
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::string all;
+            for (const std::string& w : words) {
+                all += (all.empty() ? "" : " ") + w;
+            }
+            snprintf(message, sizeof(message), "line %d: cannot assemble '%s'", line, all.c_str());
+            error = message;
+            return false;
+        }
+    }
+    for (const seq_fixup& f : fixups) {
+        auto label = labels.find(f.label);
+        if (label == labels.end()) {
+            snprintf(message, sizeof(message), "line %d: no label '%s'", f.line, f.label.c_str());
+            error = message;
+            return false;
+        }
+        if (label->second > 255) {
+            snprintf(message, sizeof(message), "line %d: label '%s' out of reach", f.line, f.label.c_str());
+            error = message;
+            return false;
+        }
+        code[f.at] = label->second;
+    }
+    return true;
+}
+
+#endif //_SEQASM_H_
@@ -0,0 +1,174 @@
+#ifndef _TOOLS_SIM_H_
+#define _TOOLS_SIM_H_
+
+// simavr setup shared by the tools that run a built firmware: the board pins,
+// loading the .elf, and a button press script. Include once per tool.
+
+#include <elf.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/avr_ioport.h>
+
+// Vector numbers of the button pin change, WDT and Timer0 compare A
+// interrupts per MCU. The LED and button pins are the firmware's own, read
+// from the BOARD_SYMBOLS() of board.h in the .elf, so a build with another
+// wiring (e.g. -D_POWER_FAIL_ on the ATtiny2313A) is driven on its pins.
+struct board {
+    const char* mcu;
+    int         pcint_vector;
+    int         wdt_vector;
+    int         timer0_vector;
+    char        led_port;
+    int         led_bit;
+    char        button_port;
+    int         button_bit;
+};
+
+static const board boards[] = {
+    { "attiny45",        2, 12, 10, 0, 0, 0, 0 },
+    { "attiny13a",       2,  8,  6, 0, 0, 0, 0 },
+    { "attiny2313a",    11, 18, 13, 0, 0, 0, 0 },
+};
+
+// Value of the global symbol `name` of a 32-bit little-endian .elf, as avr-gcc
+// writes them; false if the file is not one or has no such symbol.
+static bool elf_symbol(const char* elf, const char* name, uint32_t& value) {
+    FILE* f = fopen(elf, "rb");
+    if (!f) {
+        return false;
+    }
+    std::vector<char> image;
+    char chunk[4096];
+    for (size_t n; (n = fread(chunk, 1, sizeof(chunk), f)) > 0; ) {
+        image.insert(image.end(), chunk, chunk + n);
+    }
+    fclose(f);
+    const Elf32_Ehdr* eh = (const Elf32_Ehdr*)image.data();
+    if (image.size() < sizeof(Elf32_Ehdr) || memcmp(eh->e_ident, ELFMAG, SELFMAG) ||
+        eh->e_ident[EI_CLASS] != ELFCLASS32 || eh->e_ident[EI_DATA] != ELFDATA2LSB ||
+        eh->e_shoff + (size_t)eh->e_shnum * sizeof(Elf32_Shdr) > image.size()) {
+        return false;
+    }
+    const Elf32_Shdr* sh = (const Elf32_Shdr*)(image.data() + eh->e_shoff);
+    for (unsigned i = 0; i < eh->e_shnum; i++) {
+        if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum) {
+            continue;
+        }
+        const Elf32_Shdr& strtab = sh[sh[i].sh_link];
+        if (sh[i].sh_offset + sh[i].sh_size > image.size() ||
+            strtab.sh_offset + strtab.sh_size > image.size()) {
+            return false;
+        }
+        const Elf32_Sym* sym = (const Elf32_Sym*)(image.data() + sh[i].sh_offset);
+        for (size_t k = 0; k < sh[i].sh_size / sizeof(Elf32_Sym); k++) {
+            if (sym[k].st_name < strtab.sh_size &&
+                ELF32_ST_BIND(sym[k].st_info) == STB_GLOBAL &&
+                !strncmp(image.data() + strtab.sh_offset + sym[k].st_name, name,
+                         strtab.sh_size - sym[k].st_name)) {
+                value = sym[k].st_value;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// The board of `mcu` with the pins of the firmware `elf`.
+static bool find_board(const char* mcu, const char* elf, board& b) {
+    const board* found = NULL;
+    for (const board& row : boards) {
+        if (!strcmp(row.mcu, mcu)) {
+            found = &row;
+        }
+    }
+    if (!found) {
+        fprintf(stderr, "no board descriptor for %s\n", mcu);
+        return false;
+    }
+    b = *found;
+    uint32_t led_port, led_bit, button_port, button_bit;
+    if (!elf_symbol(elf, "__board_led_port", led_port) ||
+        !elf_symbol(elf, "__board_led_bit", led_bit) ||
+        !elf_symbol(elf, "__board_button_port", button_port) ||
+        !elf_symbol(elf, "__board_button_bit", button_bit)) {
+        fprintf(stderr, "%s: no __board_* pin symbols, see BOARD_SYMBOLS() in board.h\n", elf);
+        return false;
+    }
+    b.led_port = (char)led_port;
+    b.led_bit = led_bit;
+    b.button_port = (char)button_port;
+    b.button_bit = button_bit;
+    return true;
+}
+
+static avr_t* sim_load(const char* elf, const board& b, uint32_t f_cpu) {
+    elf_firmware_t firmware;
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(elf, &firmware)) {
+        fprintf(stderr, "%s: cannot load\n", elf);
+        return NULL;
+    }
+    avr_t* avr = avr_make_mcu_by_name(b.mcu);
+    if (!avr) {
+        fprintf(stderr, "simavr has no %s core\n", b.mcu);
+        return NULL;
+    }
+    avr_init(avr);
+    avr_load_firmware(avr, &firmware);
+    avr->frequency = f_cpu;
+    return avr;
+}
+
+static avr_irq_t* led_irq(avr_t* avr, const board& b) {
+    return avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(b.led_port), b.led_bit);
+}
+
+// Presses the mode button `count` times, `hold_ms` each, `gap_ms` apart,
+// starting at `at_ms`. Call step() before every avr_run().
+struct button_script {
+    avr_irq_t*          irq;
+    avr_cycle_count_t   at, hold, gap;
+    unsigned            count;
+
+    button_script(avr_t* avr, const board& b, unsigned count, uint32_t at_ms,
+                  uint32_t hold_ms = 100, uint32_t gap_ms = 600)
+        : irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(b.button_port), b.button_bit)),
+          at((avr_cycle_count_t)avr->frequency * at_ms / 1000),
+          hold((avr_cycle_count_t)avr->frequency * hold_ms / 1000),
+          gap((avr_cycle_count_t)avr->frequency * gap_ms / 1000), count(count) {
+        avr_raise_irq(irq, 1);              // idle high, as the pull-up keeps it
+    }
+
+    void step(avr_t* avr) {
+        if (!count || avr->cycle < at) {
+            return;
+        }
+        if (avr->cycle < at + hold) {
+            if (irq->value) {
+                avr_raise_irq(irq, 0);
+            }
+        } else {
+            avr_raise_irq(irq, 1);
+            at += gap;
+            count--;
+        }
+    }
+};
+
+// One avr_run() step; false once the firmware stopped or crashed.
+static bool sim_step(avr_t* avr, const char* elf) {
+    int state = avr_run(avr);
+    if (state == cpu_Done || state == cpu_Crashed) {
+        fprintf(stderr, "%s: firmware stopped at cycle %llu\n", elf,
+                (unsigned long long)avr->cycle);
+        return false;
+    }
+    return true;
+}
+
+#endif //_TOOLS_SIM_H_
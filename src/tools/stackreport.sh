@@ -0,0 +1,129 @@
+#!/bin/sh
+#
+# Build-time worst-case stack depth of main() and every ISR. Frame sizes
+# come from avr-gcc -fstack-usage (on AVR they include the saved registers
+# and the return address), the call graph from the disassembly; library
+# functions without a .su entry are sized by their pushes (marked ~).
+# The worst case is main plus the deepest ISR, plus a second ISR on top if
+# an ISR re-enables interrupts. It is compared with the SRAM left after
+# .data, .bss and .noinit; -D_STACK_CHECK_ builds measure the real
+# high-water mark at run time.
+#
+# Needs avr-gcc, avr-objdump and avr-size. Extra defines in FLAGS.
+# Usage: tools/stackreport.sh [MCU [F_CPU]]
+#
+
+cd "$(dirname "$0")" || exit 1
+MCU=${1:-attiny45}
+F_CPU=${2:-1000000}
+TMP=${TMPDIR:-/tmp}/stackreport.$$
+CFLAGS="-mmcu=$MCU -DF_CPU=${F_CPU}UL -Os -std=gnu++14 -fshort-enums -fno-inline-small-functions
+        -fpack-struct -fno-strict-aliasing -funsigned-char -funsigned-bitfields -ffunction-sections"
+
+case $MCU in
+attiny13a)      SRAM=64 ;;
+attiny2313a)    SRAM=128 ;;
+attiny45)       SRAM=256 ;;
+*)              echo "SRAM size of $MCU unknown" >&2; exit 1 ;;
+esac
+
+mkdir -p $TMP || exit 1
+trap 'rm -rf $TMP' EXIT
+avr-gcc $CFLAGS $FLAGS -fstack-usage -c -x c++ ../main.cpp -o $TMP/main.o || exit 1
+avr-gcc -mmcu=$MCU -Wl,--gc-sections -Wl,--relax $TMP/main.o -o $TMP/main.elf || exit 1
+STATIC=$(avr-size -A $TMP/main.elf | awk '$1 == ".data" || $1 == ".bss" || $1 == ".noinit" { n += $2 } END { print n + 0 }')
+
+echo " [STACK]    : $MCU $FLAGS"
+avr-objdump -d -C $TMP/main.elf | awk -v su=$TMP/main.su -v sram=$SRAM -v static=$STATIC '
+    function bare(name) {
+        sub(/\(.*/, "", name)
+        sub(/.* /, "", name)
+        return name
+    }
+    # frame of f plus its deepest call chain
+    function depth(f,    i, d, best) {
+        if (f in memo) {
+            return memo[f]
+        }
+        if (busy[f]) {
+            recursive[f] = 1
+            return 0
+        }
+        busy[f] = 1
+        best = 0
+        for (i = 1; i <= ncalls[f]; i++) {
+            d = depth(callee[f, i])
+            best = d > best ? d : best
+        }
+        busy[f] = 0
+        memo[f] = frame(f) + best
+        return memo[f]
+    }
+    function frame(f) {
+        return f in stack ? stack[f] : pushes[f] + 2
+    }
+    function row(label, f,    note) {
+        note = (f in stack ? "" : "~") (indirect[f] ? " +icall" : "") (recursive[f] ? " +recursion" : "") (sei[f] ? " +sei" : "")
+        printf "   %-28s %5d bytes %s\n", label, depth(f), note
+    }
+    BEGIN {
+        while ((getline line < su) > 0) {
+            split(line, field, "\t")
+            name = field[1]
+            sub(/^[^:]*:[0-9]+:[0-9]+:/, "", name)
+            stack[bare(name)] = field[2]
+            if (field[3] != "static") {
+                dynamic[bare(name)] = 1
+            }
+        }
+    }
+    /^[0-9a-f]+ <.*>:$/ {
+        fn = bare(substr($0, index($0, "<") + 1))
+        sub(/>:$/, "", fn)
+        next
+    }
+    fn == "" {
+        next
+    }
+    /\t(rcall|call)\t/ && /<.*>/ {
+        target = substr($0, index($0, "<") + 1)
+        sub(/>.*/, "", target)
+        if (target ~ /\+0x/) {
+            pushes[fn] += 2             # rcall .+0 reserves two bytes
+            next
+        }
+        target = bare(target)
+        if (!((fn, target) in seen)) {
+            seen[fn, target] = 1
+            callee[fn, ++ncalls[fn]] = target
+        }
+    }
+    /\t(icall|eicall)/ { indirect[fn] = 1 }
+    /\tpush\t/ { pushes[fn]++ }
+    /\tsei/ { sei[fn] = 1 }
+    /\tret(i)?$/ || /\tret(i)?\t/ { ended[fn] = 1 }
+    END {
+        row("main", "main")
+        worst_isr = 0; second_isr = 0; nesting = 0
+        for (f in ended) {
+            if (f ~ /^__vector_[0-9]+$/) {
+                row("ISR " f, f)
+                d = depth(f)
+                if (d > worst_isr) {
+                    second_isr = worst_isr
+                    worst_isr = d
+                } else if (d > second_isr) {
+                    second_isr = d
+                }
+                nesting = nesting || sei[f]
+            }
+        }
+        for (f in dynamic) {
+            printf "   %s has a dynamic frame, not counted\n", f
+        }
+        worst = depth("main") + worst_isr + (nesting ? second_isr : 0)
+        printf "   %-28s %5d bytes%s\n", "worst case", worst, nesting ? " (nested ISRs)" : ""
+        printf "   %-28s %5d bytes\n", "static data", static
+        printf "   %-28s %5d bytes of %d\n", "headroom", sram - static - worst, sram
+        exit sram - static - worst < 0
+    }'
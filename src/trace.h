@@ -0,0 +1,166 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+// Field trace, built in with -D_TRACE_. Keeps the last TRACE_RECORDS
+// (event, tick) records in a ring, the tick being the wake-up count, and
+// adds up the time slept in each state: every wake-up adds the WDT period
+// that was armed, in 16 ms WDT cycles. A button wake-up counts the whole
+// period it cut short, and sleeps with the WDT off have no clock and count
+// nothing. Holding the button for TRACE_HOLD_MS dumps both as 8N1 text at
+// TRACE_BAUD on TracePin instead of advancing the setting:
+//
+//    s<state> <cycles>         - one line per trace_state, 32 bits
+//    m0000 <bytes>             - stack headroom, with _STACK_CHECK_
+//    <event> <tick>            - records, oldest first, all values in hex
+//
+// With BOARD_TRACE_INVERTED the line idles low: TracePin is the IR LED
+// there, and a normal idle level would light it for the whole dump. Read it
+// with an inverting serial adapter.
+//
+// Without _TRACE_ the macros below are empty and nothing here is compiled.
+
+#ifdef _TRACE_
+
+#include "board.h"
+#include "delay.h"
+
+#ifndef TRACE_RECORDS
+#define TRACE_RECORDS                       ((RAMEND + 1 - 0x60) / 16)  // 3/16 of SRAM
+#endif
+#define TRACE_BAUD                          2400
+#define TRACE_BIT_US                        (1000000UL / TRACE_BAUD)
+#define TRACE_HOLD_MS                       2000
+#define TRACE_POLL_MS                       50
+#ifdef BOARD_TRACE_INVERTED
+#define TRACE_MARK                          0           // idle and 1 bits
+#else
+#define TRACE_MARK                          1
+#endif
+
+enum trace_event : uint8_t {
+    TRACE_BOOT,
+    TRACE_BUTTON,                           // woken by the button
+    TRACE_DISPLAY_ON,
+    TRACE_DISPLAY_OFF,
+    TRACE_PROGRAM,                          // program started
+    TRACE_SHOT,
+    TRACE_DUMP,
+    TRACE_RESUME,                           // program taken up after a WDT reset
+};
+
+enum trace_state : uint8_t {
+    TRACE_IDLE,
+    TRACE_DISPLAY,
+    TRACE_RUNNING,
+    TRACE_STATES
+};
+
+struct trace_record {
+    uint8_t     event;
+    uint16_t    tick;
+};
+
+trace_record _trace_ring[TRACE_RECORDS];
+uint8_t _trace_head = 0;                    // next record to write
+uint8_t _trace_used = 0;
+uint16_t _trace_tick = 0;
+uint32_t _trace_slept[TRACE_STATES];        // in 16 ms WDT cycles
+
+void trace(uint8_t event) {
+    _trace_ring[_trace_head].event = event;
+    _trace_ring[_trace_head].tick = _trace_tick;
+    if (++_trace_head >= TRACE_RECORDS) {
+        _trace_head = 0;
+    }
+    if (_trace_used < TRACE_RECORDS) {
+        _trace_used++;
+    }
+}
+
+static void trace_putc(uint8_t c) {
+    uint16_t bits = (c << 1) | 0x200;       // start bit, 8 data bits, stop bit
+    for (uint8_t i = 0; i < 10; i++) {
+        TracePin::set((bits & 1) ? TRACE_MARK : !TRACE_MARK);
+        bits >>= 1;
+        delay_us(TRACE_BIT_US);
+    }
+}
+
+static void trace_hex(uint16_t value) {
+    for (uint8_t shift = 16; shift;) {
+        shift -= 4;
+        uint8_t digit = (value >> shift) & 0x0F;
+        trace_putc(digit < 10 ? '0' + digit : 'a' - 10 + digit);
+    }
+}
+
+static void trace_eol() {
+    trace_putc('\r');
+    trace_putc('\n');
+}
+
+static void trace_line(uint8_t first, uint16_t value) {
+    trace_hex(first);
+    trace_putc(' ');
+    trace_hex(value);
+    trace_eol();
+}
+
+// the period slept, read back from WDTCR: WDE or WDIE set means it ran
+static inline void trace_wake(uint8_t state) {
+    _trace_tick++;
+    uint8_t wdt = WDTCR;
+    if (wdt & ((1 << WDE) | (1 << WDIE))) {
+        _trace_slept[state] += 1UL << ((wdt & 0x07) | (wdt >> WDP3 & 1) << 3);
+    }
+}
+
+// true once the button stayed down for TRACE_HOLD_MS
+bool trace_long_press() {
+    for (uint16_t held = 0; held < TRACE_HOLD_MS; held += TRACE_POLL_MS) {
+        if (ButtonPin::is_high()) {
+            return false;
+        }
+        delay_us(TRACE_POLL_MS * 1000UL);
+    }
+    return true;
+}
+
+void trace_dump() {
+    trace(TRACE_DUMP);
+    TracePin::set(TRACE_MARK);              // line idle
+    TracePin::output();
+    delay_us(10 * TRACE_BIT_US);
+    for (uint8_t state = 0; state < TRACE_STATES; state++) {
+        trace_putc('s');
+        trace_hex(state);
+        trace_putc(' ');
+        trace_hex(_trace_slept[state] >> 16);
+        trace_hex(_trace_slept[state]);
+        trace_eol();
+    }
+#ifdef STACK_CANARY
+    trace_putc('m');
+    trace_line(0, stack_unused());
+#endif
+    uint8_t i = _trace_head + TRACE_RECORDS - _trace_used;
+    for (uint8_t n = _trace_used; n; n--, i++) {
+        if (i >= TRACE_RECORDS) {
+            i -= TRACE_RECORDS;
+        }
+        trace_line(_trace_ring[i].event, _trace_ring[i].tick);
+    }
+    TracePin::low();                        // at rest, the IR LED dark
+}
+
+#define TRACE(EVENT)                        trace(EVENT)
+#define TRACE_WAKE(STATE)                   trace_wake(STATE)
+
+#else
+
+#define TRACE(EVENT)
+#define TRACE_WAKE(STATE)
+
+#endif //_TRACE_
+
+#endif //_TRACE_H_
@@ -0,0 +1,184 @@
+#ifndef _WAIT_H_
+#define _WAIT_H_
+
+#include "delay.h"
+
+// Waits that spend US at F_CPU in the cheapest sleep mode, chosen at compile
+// time from the supply current of each mode and the cycles it costs to get
+// in and out of it:
+//
+//    BUSY        delay_us(), the CPU runs through the wait
+//    IDLE        Timer0 in CTC mode wakes the CPU from IDLE sleep every COUNT
+//                timer ticks, TURNS times; the cycles the timer cannot
+//                resolve are spun after the last wake-up
+//
+// Power-down stays with _power_sleep(): the WDT is the clock of the program
+// tick there, and its shortest period, 16 ms +-10 %, is coarser than any
+// wait here. The IR timing of an IDLE wait is off by the difference between
+// the WAIT_IDLE_* cycle counts and the real ones; tools/irwave measures it.
+// tools/delayreport prints every plan.
+//
+// WAIT_IDLE_SETUP, _WAKE and _EXIT are estimates counted by hand from the
+// C source, not from compiler output, and decide between IDLE and BUSY for
+// waits near the break-even. tools/bench.sh times wait_idle() and
+// ISR(TIMER0_COMPA_vect): a call's cycles less its TURNS * COUNT timer
+// cycles are SETUP + EXIT plus one WAKE per turn but the last. Replace the
+// estimates with those figures.
+//
+// WAIT_IDLE 0 makes every wait a BUSY one and leaves out the Timer0 ISR and
+// wait_idle(), about 100 bytes; the default on parts with 1 KB of FLASH,
+// the ATtiny13A, whose image has no room to spare. FLASHEND comes from
+// <avr/io.h>, include it first.
+
+#ifndef WAIT_ACTIVE_UA
+#define WAIT_ACTIVE_UA                      550         // see host/currents.cfg
+#endif
+#ifndef WAIT_IDLE_UA
+#define WAIT_IDLE_UA                        110         // Timer0 running
+#endif
+#define WAIT_IDLE_SETUP                     30          // call to the timer start, estimate
+#define WAIT_IDLE_WAKE                      40          // wake-up, ISR, back to sleep, estimate
+#define WAIT_IDLE_EXIT                      55          // last compare to the return, estimate
+#define WAIT_IDLE_MAX_TURNS                 255
+#ifndef WAIT_IDLE
+#if !defined(FLASHEND) || FLASHEND > 0x3FF
+#define WAIT_IDLE                           1
+#else
+#define WAIT_IDLE                           0
+#endif
+#endif
+
+namespace wait {
+
+enum : uint8_t { BUSY, IDLE };
+
+// CS0 bits of TCCR0B, 1 .. 5
+constexpr uint16_t prescale(uint8_t cs) {
+    return cs == 1 ? 1 : cs == 2 ? 8 : cs == 3 ? 64 : cs == 4 ? 256 : 1024;
+}
+
+constexpr uint32_t ticks(uint32_t n, uint8_t cs) {
+    return n > WAIT_IDLE_SETUP + WAIT_IDLE_EXIT ?
+           (n - WAIT_IDLE_SETUP - WAIT_IDLE_EXIT) / prescale(cs) : 0;
+}
+
+constexpr uint32_t turns(uint32_t n, uint8_t cs) {
+    return (ticks(n, cs) + 255) / 256;
+}
+
+constexpr uint16_t count(uint32_t n, uint8_t cs) {
+    return turns(n, cs) ? ticks(n, cs) / turns(n, cs) : 0;
+}
+
+constexpr uint32_t timed(uint32_t n, uint8_t cs) {
+    return turns(n, cs) * count(n, cs) * prescale(cs);
+}
+
+// a turn must outlast the wake-up that ends the one before
+constexpr bool usable(uint32_t n, uint8_t cs) {
+    return turns(n, cs) >= 1 && turns(n, cs) <= WAIT_IDLE_MAX_TURNS &&
+           count(n, cs) * (uint32_t)prescale(cs) > 2 * WAIT_IDLE_WAKE;
+}
+
+constexpr uint32_t idle_cycles(uint32_t n, uint8_t cs) {
+    return timed(n, cs) - (turns(n, cs) - 1) * WAIT_IDLE_WAKE;
+}
+
+// charge in uA * cycles
+constexpr uint64_t cost(uint32_t n, uint8_t cs) {
+    return !usable(n, cs) ? UINT64_MAX :
+           (uint64_t)(n - idle_cycles(n, cs)) * WAIT_ACTIVE_UA +
+           (uint64_t)idle_cycles(n, cs) * WAIT_IDLE_UA;
+}
+
+constexpr uint8_t best(uint32_t n, uint8_t cs = 5) {
+    return cs == 1 ? 1 : cost(n, cs) <= cost(n, best(n, cs - 1)) ? cs : best(n, cs - 1);
+}
+
+constexpr uint8_t kind(uint32_t n) {
+    return WAIT_IDLE && cost(n, best(n)) < (uint64_t)n * WAIT_ACTIVE_UA ? IDLE : BUSY;
+}
+
+// cycles spun after the last wake-up
+constexpr uint32_t rest(uint32_t n) {
+    return kind(n) == IDLE ? n - WAIT_IDLE_SETUP - WAIT_IDLE_EXIT - timed(n, best(n)) : n;
+}
+
+} // namespace wait
+
+// the planner builds anywhere, the waits need Timer0
+#ifdef TCCR0A
+
+#include <avr/interrupt.h>
+#ifdef PRR
+#include <avr/power.h>
+#endif
+#include <avr/sleep.h>
+#include "board.h"
+
+#if WAIT_IDLE
+
+volatile uint8_t _wait_turns;
+
+ISR(TIMER0_COMPA_vect) {
+    _wait_turns--;
+}
+
+// COM, the COM0A bits, also toggles OC0A on every compare, see motion.h
+static void __attribute__((noinline)) wait_idle(uint8_t cs, uint8_t turns, uint8_t top, uint8_t com = 0) {
+#ifdef PRTIM0
+    power_timer0_enable();
+#endif
+    _wait_turns = turns;
+    OCR0A = top;
+    TCNT0 = 0;
+    TCCR0A = (1 << WGM01) | com;            // CTC
+    TIMSK |= (1 << OCIE0A);
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    cli();
+    GTCCR = (1 << PSR0);                    // the first tick is a whole one
+    TCCR0B = cs;
+    while (_wait_turns) {
+        // woken by the other interrupts too, they do not end a turn
+        sei();
+        sleep_cpu();
+        cli();
+    }
+    sei();
+    sleep_disable();
+    TCCR0B = 0x00;
+    TCCR0A = 0x00;                          // OC0A back to its port pin
+    TIMSK &= ~(1 << OCIE0A);
+#ifdef PRTIM0
+    power_timer0_disable();
+#endif
+}
+
+#endif //WAIT_IDLE
+
+namespace wait {
+
+template <uint32_t N>
+static inline __attribute__((always_inline)) void cycles() {
+#if WAIT_IDLE
+    if (kind(N) == IDLE) {
+        wait_idle(best(N), turns(N, best(N)), count(N, best(N)) - 1);
+    }
+#endif
+    delay::cycles<rest(N)>();
+}
+
+} // namespace wait
+
+#define wait_us(US)                                                             \
+    do {                                                                        \
+        static_assert(DELAY_CYCLES(US) > 0, "wait shorter than one cycle");     \
+        static_assert(delay::error_ppm((US), F_CPU) <= DELAY_TOLERANCE_PPM,     \
+                      "wait not representable in whole cycles at F_CPU");       \
+        wait::cycles<DELAY_CYCLES(US)>();                                       \
+    } while (0)
+
+#endif //TCCR0A
+
+#endif //_WAIT_H_